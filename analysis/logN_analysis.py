@@ -9,9 +9,9 @@ from utils import config
 import matplotlib.pyplot as plt
 from utils.args import parse_args, build_filters
 from  utils.bitflip_utils import bits_to_flip_generator
-from utils.io_utils import load_campaign_data, load_and_filter_campaigns
+from utils.io_utils import load_campaign_data, load_and_filter_campaigns, load_summary_data
 from utils.plotters import plot_bit
-from utils.df_utils import stats_by_bit
+from utils.df_utils import stats_by_bit, stats_by_bit_summary
 
 show = config.show
 width = int(config.width)
@@ -48,12 +48,14 @@ def main():
     if selected_small.empty:
         raise RuntimeError("No hay campañas que cumplan los filtros")
 
-    data_large = load_campaign_data(selected_large, config.DATA_DIR)
-    data_small = load_campaign_data(selected_small, config.DATA_DIR)
-
     ########################## STATS ###############################
-    df_small = stats_by_bit(data_small)
-    df_large = stats_by_bit(data_large)
+    if args.summary:
+        # Per-bit rows of aggregateCampaigns instead of every flip
+        df_small = stats_by_bit_summary(load_summary_data(selected_small, config.SUMMARY_CSV, "bit"))
+        df_large = stats_by_bit_summary(load_summary_data(selected_large, config.SUMMARY_CSV, "bit"))
+    else:
+        df_small = stats_by_bit(load_campaign_data(selected_small, config.DATA_DIR))
+        df_large = stats_by_bit(load_campaign_data(selected_large, config.DATA_DIR))
 
     ########################## PLOT ################################
     fig, ax = plt.subplots(figsize=(12, 5))
@@ -18,6 +18,8 @@ def parse_args():
     parser.add_argument("--library", type=str, default=None)
     parser.add_argument("--stage", type=str, default=None)
     parser.add_argument("--title", type=str, default=None)
+    # Read config.SUMMARY_CSV (aggregateCampaigns) instead of the per-flip data
+    parser.add_argument("--summary", type=str2bool, default=False)
 
     # -------- opcionales con default --------
     parser.add_argument("--bitPerCoeff", type=int, default=64)
@@ -7,6 +7,8 @@ sys.path.append(os.path.abspath('./'))
 CAMPAIGNS_CSV = "../results/campaigns_start.csv"
 CAMPAIGNS_END_CSV = "../results/campaigns_end.csv"
 DATA_DIR = Path("../results/data")
+# backends/aggregate/build/bin/aggregateCampaigns --results ../results
+SUMMARY_CSV = "../results/summary.csv"
 
 CAMPAIGNS_NN_CSV = "../results_NN/campaigns_start.csv"
 DATA_NN_DIR = Path("../results_NN/data")
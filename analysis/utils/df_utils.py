@@ -147,3 +147,27 @@ def stats_by_bit_sdc(data):
         )
     )
     return stats
+
+
+def stats_by_bit_summary(rows):
+    """
+    stats_by_bit columns from the "bit" rows of summary.csv (load_summary_data):
+    l2 mean weighted by each campaign's flips, global min and max. The
+    summaries keep no per-coefficient means, so there is no std_l2.
+    """
+    rows = rows.copy()
+    rows["n_l2"] = rows["count"] - rows["crashed"]
+    rows["l2_sum"] = rows["l2_mean"] * rows["n_l2"]
+    stats = (
+        rows
+        .groupby("bit", as_index=False)
+        .agg(
+            l2_sum=("l2_sum", "sum"),
+            n_l2=("n_l2", "sum"),
+            min_l2=("l2_min", "min"),
+            max_l2=("l2_max", "max"),
+        )
+    )
+    stats["mean_l2"] = stats["l2_sum"] / stats["n_l2"]
+    stats["bit"] = stats["bit"].astype(int)
+    return stats.drop(columns=["l2_sum", "n_l2"])
@@ -157,3 +157,16 @@ def load_end_data(selected_campaigns, csv_file, id_col="campaign_id"):
 
     return filtered_df
 
+
+def load_summary_data(selected_campaigns, summary_csv, level="bit"):
+    """
+    Rows of `level` (all, bit, limb, coeff, limb_bit) written by
+    backends/aggregate/aggregateCampaigns for the selected campaigns,
+    instead of the per-flip data of load_campaign_data.
+    """
+    summary = pd.read_csv(summary_csv)
+    ids = set(int(x) for x in selected_campaigns["campaign_id"])
+    data = summary[(summary["level"] == level) & summary["campaign_id"].isin(ids)]
+    if data.empty:
+        raise RuntimeError(f"No {level} rows in {summary_csv} for the selected campaigns")
+    return data
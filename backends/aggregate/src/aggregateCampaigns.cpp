@@ -0,0 +1,390 @@
+#include "campaign_summary.h"
+#include "csv_encoder.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace fs = std::filesystem;
+
+// Streams the per-flip campaign files (campaign_<id>.csv.gz, or .csv) and
+// writes one summary CSV: the campaign's campaigns_start.csv row joined to
+// every per-bit/per-limb/per-coefficient row of CampaignSummary. Memory is
+// one summary per campaign, whatever the file sizes. Campaigns run with
+// --record aggregate already left summary_<id>.csv in the same schema: its
+// rows are joined as they are.
+
+namespace {
+
+// Lines of a gzip (or plain: zlib reads it through) file, without the
+// trailing '\n' / "\r\n". The views are valid until the next call.
+class GzLineReader {
+public:
+    explicit GzLineReader(const std::string& path) : path_(path), buf_(1 << 20)
+    {
+        f_ = gzopen(path.c_str(), "rb");
+        if (!f_)
+            throw std::runtime_error("aggregateCampaigns: no se pudo abrir " + path);
+        gzbuffer(f_, 1 << 18);
+    }
+    ~GzLineReader() { if (f_) gzclose(f_); }
+    GzLineReader(const GzLineReader&) = delete;
+    GzLineReader& operator=(const GzLineReader&) = delete;
+
+    bool next(std::string_view& line)
+    {
+        for (;;) {
+            const char* start = buf_.data() + pos_;
+            const char* nl = static_cast<const char*>(std::memchr(start, '\n', len_ - pos_));
+            if (nl) {
+                size_t n = static_cast<size_t>(nl - start);
+                pos_ += n + 1;
+                if (n > 0 && start[n - 1] == '\r')
+                    n--;
+                line = std::string_view(start, n);
+                return true;
+            }
+            if (eof_) {
+                if (pos_ == len_)
+                    return false;
+                line = std::string_view(start, len_ - pos_);   // last line without '\n'
+                pos_ = len_;
+                return true;
+            }
+            fill();
+        }
+    }
+
+private:
+    void fill()
+    {
+        // Keep the partial line, grow if it fills the whole buffer
+        std::copy(buf_.begin() + pos_, buf_.begin() + len_, buf_.begin());
+        len_ -= pos_;
+        pos_ = 0;
+        if (len_ == buf_.size())
+            buf_.resize(buf_.size() * 2);
+        int n = gzread(f_, buf_.data() + len_, static_cast<unsigned>(buf_.size() - len_));
+        if (n < 0) {
+            int err;
+            throw std::runtime_error("aggregateCampaigns: error de zlib en " + path_ + ": " + gzerror(f_, &err));
+        }
+        if (n == 0)
+            eof_ = true;
+        len_ += static_cast<size_t>(n);
+    }
+
+    std::string path_;
+    gzFile f_ = nullptr;
+    std::vector<char> buf_;
+    size_t pos_ = 0, len_ = 0;
+    bool eof_ = false;
+};
+
+void split(std::string_view line, std::vector<std::string_view>& fields)
+{
+    fields.clear();
+    size_t start = 0;
+    for (;;) {
+        size_t comma = line.find(',', start);
+        fields.push_back(line.substr(start, comma == std::string_view::npos ? comma : comma - start));
+        if (comma == std::string_view::npos)
+            return;
+        start = comma + 1;
+    }
+}
+
+template <typename T>
+bool parse(std::string_view s, T& out)
+{
+    auto res = std::from_chars(s.data(), s.data() + s.size(), out);
+    return res.ec == std::errc() && res.ptr == s.data() + s.size();
+}
+
+// Per-flip columns the summary needs, by position in the file's header
+struct Columns {
+    int limb = -1, coeff = -1, bit = -1, l2 = -1, sdc = -1;
+    int correct = -1, degraded = -1, corrupted = -1, failed = -1;
+    int crashed = -1;   // absent in files older than the fork server
+
+    explicit Columns(const std::vector<std::string_view>& header)
+    {
+        for (int i = 0; i < static_cast<int>(header.size()); ++i) {
+            const std::string_view h = header[i];
+            if (h == "limb") limb = i;
+            else if (h == "coeff") coeff = i;
+            else if (h == "bit") bit = i;
+            else if (h == "l2_norm") l2 = i;
+            else if (h == "is_sdc") sdc = i;
+            else if (h == "correct") correct = i;
+            else if (h == "degraded") degraded = i;
+            else if (h == "corrupted") corrupted = i;
+            else if (h == "failed") failed = i;
+            else if (h == "crashed") crashed = i;
+        }
+        for (int c : {limb, coeff, bit, l2, sdc, correct, degraded, corrupted, failed})
+            if (c < 0)
+                throw std::runtime_error("aggregateCampaigns: falta una columna en la cabecera");
+    }
+};
+
+// Adds every row of one campaign file to summary; returns the rows skipped
+uint64_t summarize_file(const std::string& path, CampaignSummary& summary)
+{
+    GzLineReader in(path);
+    std::string_view line;
+    std::vector<std::string_view> f;
+    if (!in.next(line))
+        return 0;
+    split(line, f);
+    const Columns col(f);
+
+    uint64_t bad = 0;
+    while (in.next(line)) {
+        if (line.empty())
+            continue;
+        split(line, f);
+        uint32_t limb, coeff, bit, sdc, crashed = 0;
+        double l2;
+        SlotErrorStats s;
+        const int last = std::max({col.limb, col.coeff, col.bit, col.l2, col.sdc, col.correct,
+                                   col.degraded, col.corrupted, col.failed, col.crashed});
+        if (static_cast<int>(f.size()) <= last ||
+            !parse(f[col.limb], limb) || !parse(f[col.coeff], coeff) || !parse(f[col.bit], bit) ||
+            !parse(f[col.l2], l2) || !parse(f[col.sdc], sdc) ||
+            !parse(f[col.correct], s.correct) || !parse(f[col.degraded], s.degraded) ||
+            !parse(f[col.corrupted], s.corrupted) || !parse(f[col.failed], s.failed) ||
+            (col.crashed >= 0 && !parse(f[col.crashed], crashed))) {
+            bad++;
+            continue;
+        }
+        summary.add(limb, coeff, bit, l2, sdc != 0, s, crashed != 0);
+    }
+    return bad;
+}
+
+// campaigns_start.csv: header and, per campaign id, the rest of its row as
+// written (already CSV encoded)
+struct StartTable {
+    std::string header;   // without campaign_id
+    size_t columns = 0;
+    std::map<uint32_t, std::string> rows;
+
+    explicit StartTable(const std::string& path)
+    {
+        GzLineReader in(path);
+        std::string_view line;
+        if (!in.next(line))
+            throw std::runtime_error("aggregateCampaigns: " + path + " vacio");
+        const size_t comma = line.find(',');
+        header = std::string(line.substr(comma == std::string_view::npos ? line.size() : comma + 1));
+        columns = static_cast<size_t>(std::count(header.begin(), header.end(), ',')) + 1;
+        while (in.next(line)) {
+            const size_t c = line.find(',');
+            uint32_t id;
+            if (c == std::string_view::npos || !parse(line.substr(0, c), id))
+                continue;
+            rows.emplace(id, std::string(line.substr(c + 1)));
+        }
+    }
+
+    // campaign_id plus its start fields (empty ones when unknown)
+    std::string prefix(uint32_t id) const
+    {
+        std::string p = std::to_string(id) + ",";
+        auto it = rows.find(id);
+        p += it != rows.end() ? it->second : std::string(columns - 1, ',');
+        return p;
+    }
+};
+
+// campaign_000042.csv.gz -> 42; summary_000042.csv -> 42, summary
+bool data_file_id(const fs::path& p, uint32_t& id, bool& summary)
+{
+    std::string name = p.filename().string();
+    const size_t underscore = name.find('_');
+    if (underscore == std::string::npos)
+        return false;
+    const std::string kind = name.substr(0, underscore);
+    name = name.substr(underscore + 1);
+    const size_t dot = name.find('.');
+    if (dot == std::string::npos)
+        return false;
+    const std::string ext = name.substr(dot);
+    if (kind == "campaign" && (ext == ".csv.gz" || ext == ".csv"))
+        summary = false;
+    else if (kind == "summary" && ext == ".csv")
+        summary = true;
+    else
+        return false;
+    return parse(std::string_view(name).substr(0, dot), id);
+}
+
+// Rows of a --record aggregate summary, campaign_id replaced by prefix.
+// coeff and limb_bit rows are kept only with perCoeff/perLimbBit, as for
+// the campaigns summarized here.
+void join_summary_file(const std::string& path, const std::string& prefix,
+                       bool perCoeff, bool perLimbBit, CsvEncoder& out)
+{
+    GzLineReader in(path);
+    std::string_view line;
+    if (!in.next(line))
+        return;
+    while (in.next(line)) {
+        const size_t comma = line.find(',');
+        if (line.empty() || comma == std::string_view::npos)
+            continue;
+        const std::string_view row = line.substr(comma + 1);
+        const std::string_view level = row.substr(0, row.find(','));
+        if ((level == "coeff" && !perCoeff) || (level == "limb_bit" && !perLimbBit))
+            continue;
+        out.raw(prefix).raw(row);
+        out.endRow();
+    }
+}
+
+// Output file descriptor, closed on every exit path
+class OutputFile {
+public:
+    explicit OutputFile(const std::string& path)
+    {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+            throw std::runtime_error("aggregateCampaigns: no se pudo crear " + path);
+    }
+    ~OutputFile() { if (fd_ >= 0) ::close(fd_); }
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    int fd() const { return fd_; }
+
+private:
+    int fd_ = -1;
+};
+
+// File to read for one campaign
+struct DataFile {
+    std::string path;
+    bool summary = false;
+};
+
+void usage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options] [campaign_id ...]\n\n"
+              << "Options:\n"
+              << "  --results <dir>   Results directory with campaigns_start.csv and data/ (default: results)\n"
+              << "  --out <file>      Summary CSV (default: <results>/summary.csv)\n"
+              << "  --noCoeff         Skip the per-coefficient rows\n"
+              << "  --limbBit         Add per-(limb, bit) rows\n"
+              << "  --help, -h        Show this help\n\n"
+              << "Without ids, every campaign file in <results>/data is summarized.\n"
+              << "summary_<id>.csv files (--record aggregate) are joined as written.\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string resultsDir = "results";
+    std::string outPath;
+    bool perCoeff = true, perLimbBit = false;
+
+    static struct option long_options[] = {
+        {"results", required_argument, 0, 'r'},
+        {"out",     required_argument, 0, 'o'},
+        {"noCoeff", no_argument,       0, 'c'},
+        {"limbBit", no_argument,       0, 'l'},
+        {"help",    no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt, option_index = 0;
+    while ((opt = getopt_long(argc, argv, "r:o:clh", long_options, &option_index)) != -1) {
+        switch (opt) {
+            case 'r': resultsDir = optarg; break;
+            case 'o': outPath = optarg; break;
+            case 'c': perCoeff = false; break;
+            case 'l': perLimbBit = true; break;
+            case 'h': usage(argv[0]); return 0;
+            default:  usage(argv[0]); return 1;
+        }
+    }
+    if (outPath.empty())
+        outPath = resultsDir + "/summary.csv";
+
+    try {
+        const fs::path dataDir = fs::path(resultsDir) / "data";
+        // id -> file; per-flip rows win over a summary, .csv.gz over a
+        // leftover .csv
+        std::map<uint32_t, DataFile> files;
+        for (const auto& e : fs::directory_iterator(dataDir)) {
+            uint32_t id;
+            bool summary;
+            if (!e.is_regular_file() || !data_file_id(e.path(), id, summary))
+                continue;
+            auto it = files.find(id);
+            if (it == files.end() || (it->second.summary && !summary) ||
+                (!summary && e.path().extension() == ".gz"))
+                files[id] = {e.path().string(), summary};
+        }
+        if (optind < argc) {
+            std::map<uint32_t, DataFile> selected;
+            for (int i = optind; i < argc; ++i) {
+                uint32_t id;
+                if (!parse(std::string_view(argv[i]), id))
+                    throw std::invalid_argument(std::string("campaign_id invalido: ") + argv[i]);
+                auto it = files.find(id);
+                if (it == files.end())
+                    std::cerr << "[WARN] no data file for campaign " << id << "\n";
+                else
+                    selected.insert(*it);
+            }
+            files.swap(selected);
+        }
+
+        const StartTable start(resultsDir + "/campaigns_start.csv");
+
+        OutputFile outFile(outPath);
+        const int fd = outFile.fd();
+        CsvEncoder out;
+        out.raw("campaign_id").raw(start.header).raw(CampaignSummary::header());
+        out.endRow();
+
+        for (const auto& [id, file] : files) {
+            const std::string& path = file.path;
+            if (!start.rows.count(id))
+                std::cerr << "[WARN] campaign " << id << " is not in campaigns_start.csv\n";
+            if (file.summary) {
+                join_summary_file(path, start.prefix(id), perCoeff, perLimbBit, out);
+                out.flushTo(fd, outPath);
+                std::cout << "[INFO] campaign " << id << ": joined " << path << "\n";
+                continue;
+            }
+            CampaignSummary summary(perCoeff, perLimbBit);
+            uint64_t bad = summarize_file(path, summary);
+            if (bad)
+                std::cerr << "[WARN] " << path << ": " << bad << " malformed rows skipped\n";
+            summary.encode(out, start.prefix(id));
+            out.flushTo(fd, outPath);
+            std::cout << "[INFO] campaign " << id << ": " << summary.total() << " flips\n";
+        }
+        std::cout << "[INFO] " << files.size() << " campaigns summarized -> " << outPath << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "backend_interface.h"
+#include "backend_heaan.h"
 
 // HEAAN-only includes
 #include "HEAAN.h"
@@ -7,60 +8,146 @@
 #include <vector>
 #include <complex>
 #include <algorithm>
+#include <sstream>
+#include "snapshot_store.h"
+#include "campaign_logger.h"
 
 const size_t MAX_H = 64;
 
 long logq_boot = 40;
-struct HEAANContext : BackendContext {
-    Context cc;
-    SecretKey sk;
-    Scheme scheme;
-
-    std::vector<double> baseInput;
-    std::vector<double> goldenOutput;
-    std::vector<std::complex<double>> baseInputComplex;
-    std::vector<std::complex<double>> goldenOutputComplex;
-    NTL::ZZ seed;
-
-    HEAANContext(
-        uint32_t logN,
-        uint32_t logQ,
-        uint32_t h,
-        uint64_t seed_
-    )
-        : cc(logN, logQ)
-        , sk(logN, h)
-        , scheme(sk, cc)   // ← ahora sí
-        , seed(NTL::ZZ(seed_))
-    {}
-
-    HEAANContext(const HEAANContext&) = delete;
-    HEAANContext& operator=(const HEAANContext&) = delete;
+
+// Server ops in pipeline order: doAdd adds, doPlainMul plain products,
+// doMul products (each with its rescale) and the rotation. depth is the
+// index among ops of the same kind, the one op_depth selects.
+enum class ServerOp { Add, PlainMul, Mul, Rot };
+struct ServerStep {
+    ServerOp op;
+    uint32_t depth;
 };
 
-std::vector<double> get_reference_output(const BackendContext* bctx)
+static std::vector<ServerStep> server_steps(const CampaignArgs& args)
 {
-    auto& ctx = static_cast<const HEAANContext&>(*bctx);
-    return ctx.goldenOutput;
+    std::vector<ServerStep> steps;
+    for (uint32_t i = 0; i < args.doAdd; ++i)      steps.push_back({ServerOp::Add, i});
+    for (uint32_t i = 0; i < args.doPlainMul; ++i) steps.push_back({ServerOp::PlainMul, i});
+    for (uint32_t i = 0; i < args.doMul; ++i)      steps.push_back({ServerOp::Mul, i});
+    if (args.doRot > 0)                            steps.push_back({ServerOp::Rot, 0});
+    return steps;
 }
 
-std::vector<double> get_reference_output_complex(const BackendContext* bctx)
+// Raw layout of a ZZX with N coefficients: N, words per coefficient W,
+// a sign bitmap of N bits, then |coeff| as W little-endian words each
+static void put_poly(SnapshotWriter& w, const ZZX& p, long N)
 {
-    auto& ctx = static_cast<const HEAANContext&>(*bctx);
+    long bits = 0;
+    for (long i = 0; i < N; ++i)
+        bits = std::max(bits, NumBits(coeff(p, i)));
+    const long W = std::max<long>(1, (bits + 63) / 64);
+    const long signWords = (N + 63) / 64;
+    w.put(static_cast<uint64_t>(N));
+    w.put(static_cast<uint64_t>(W));
+    uint64_t* out = w.extend(signWords + N * W);
+    std::fill(out, out + signWords, 0);
+    for (long i = 0; i < N; ++i) {
+        const ZZ& a = coeff(p, i);
+        if (sign(a) < 0)
+            out[i / 64] |= 1ULL << (i % 64);
+        BytesFromZZ(reinterpret_cast<unsigned char*>(out + signWords + i * W), a, W * 8);
+    }
+}
 
-    const auto& g = ctx.goldenOutputComplex;
-    const size_t n = g.size();
+static ZZX get_poly(SnapshotReader& r)
+{
+    const long N = static_cast<long>(r.get());
+    const long W = static_cast<long>(r.get());
+    const uint64_t* signs = r.take((N + 63) / 64);
+    const uint64_t* mags = r.take(N * W);
+    ZZX p;
+    ZZ a;
+    for (long i = 0; i < N; ++i) {
+        ZZFromBytes(a, reinterpret_cast<const unsigned char*>(mags + i * W), W * 8);
+        if ((signs[i / 64] >> (i % 64)) & 1)
+            NTL::negate(a, a);
+        SetCoeff(p, i, a);
+    }
+    return p;
+}
+
+static void put_cipher(SnapshotWriter& w, const Ciphertext& c, long N)
+{
+    w.put(static_cast<uint64_t>(c.logp));
+    w.put(static_cast<uint64_t>(c.logq));
+    w.put(static_cast<uint64_t>(c.slots));
+    w.put(c.isComplex ? 1 : 0);
+    put_poly(w, c.bx, N);
+    put_poly(w, c.ax, N);
+}
+
+static Ciphertext get_cipher(SnapshotReader& r)
+{
+    Ciphertext c;
+    c.logp = static_cast<long>(r.get());
+    c.logq = static_cast<long>(r.get());
+    c.slots = static_cast<long>(r.get());
+    c.isComplex = r.get() != 0;
+    c.bx = get_poly(r);
+    c.ax = get_poly(r);
+    return c;
+}
 
-    std::vector<double> out(2 * n);
+// Everything the clean input depends on, plus the secret key and the
+// evaluation keys setup_campaign generates after it. The boot keys come
+// first and draw from the PRNG, so the rotation key (and any later state)
+// differs between doBoot=0 and doBoot=1 under the same seed.
+static std::string snapshot_prefix(const HEAANContext& ctx, const CampaignArgs& args)
+{
+    SnapshotWriter sk;
+    put_poly(sk, ctx.sk.sx, ctx.cc.N);
+    const auto& words = sk.words();
+    std::ostringstream os;
+    os << "heaan logN=" << args.logN << " logQ=" << args.logQ
+       << " logDelta=" << args.logDelta << " logSlots=" << args.logSlots
+       << " isComplex=" << args.isComplex << " seed=" << args.seed
+       << " seed_input=" << args.seed_input << " logMin=" << args.logMin
+       << " logMax=" << args.logMax
+       << " bootKey=" << args.doBoot
+       << " rotKey=" << (args.doRot ? (1ULL << (args.doRot - 1)) : 0)
+       << " sk=" << std::hex
+       << fnv1a64(words.data(), words.size() * sizeof(uint64_t));
+    return os.str();
+}
 
-    for (size_t i = 0; i < n; ++i) {
-        out[i]     = g[i].real();
-        out[i + n] = g[i].imag();
+// Description of the state after the first k steps
+static std::string snapshot_description(const std::string& prefix, const CampaignArgs& args,
+                                        const std::vector<ServerStep>& steps, size_t k)
+{
+    std::ostringstream os;
+    os << prefix << " ops=";
+    for (size_t i = 0; i < k; ++i) {
+        switch (steps[i].op) {
+            case ServerOp::Add:      os << "add,"; break;
+            case ServerOp::PlainMul: os << "pmul,"; break;
+            case ServerOp::Mul:      os << "mul,"; break;
+            case ServerOp::Rot:      os << "rot" << (1ULL << (args.doRot - 1)) << ','; break;
+        }
     }
+    return os.str();
+}
+
+std::vector<double> get_reference_output(const BackendContext* bctx)
+{
+    auto& ctx = static_cast<const HEAANContext&>(*bctx);
+    return ctx.goldenOutput;
+}
 
-    return out;
+const std::vector<cdouble>& get_reference_output_complex(const BackendContext* bctx)
+{
+    auto& ctx = static_cast<const HEAANContext&>(*bctx);
+    return ctx.goldenOutputComplex;
 }
 
+static void prepare_snapshots(HEAANContext& ctx, const CampaignArgs& args);
+
 BackendContext* setup_campaign(const CampaignArgs& args)
 {
     long h;
@@ -82,10 +169,28 @@ BackendContext* setup_campaign(const CampaignArgs& args)
     }
     if(args.isComplex>0){
         compute_plain_io(args, ctx->baseInputComplex, ctx->goldenOutputComplex);
+        const long baseSize = ctx->baseInputComplex.size();
+        ctx->plainInput = ctx->scheme.encode(ctx->baseInputComplex.data(), baseSize,
+                                             args.logDelta, args.logQ);
+        if(args.doPlainMul)
+            ctx->mxPlainMul = ctx->cc.encode(ctx->baseInputComplex.data(), baseSize, args.logDelta);
     } else{
         compute_plain_io(args, ctx->baseInput, ctx->goldenOutput);
+        const long baseSize = ctx->baseInput.size();
+        ctx->plainInput = ctx->scheme.encode(ctx->baseInput.data(), baseSize,
+                                             args.logDelta, args.logQ);
+        if(args.doPlainMul)
+            ctx->mxPlainMul = ctx->cc.encode(ctx->baseInput.data(), baseSize, args.logDelta);
     }
 
+    if (args.snapshots) {
+        prepare_snapshots(*ctx, args);
+        return ctx;
+    }
+    ctx->cInput = ctx->scheme.encryptMsg(ctx->plainInput, ctx->seed);
+    if(args.doAdd || args.doMul)
+        ctx->cClean = ctx->scheme.encryptMsg(ctx->plainInput, ctx->seed);
+
     return ctx;
 }
 
@@ -94,75 +199,149 @@ void flipBit(uint32_t amount, ZZX& poly, uint32_t coeff, uint32_t bit) {
         SwitchBit(poly[coeff], b);
     }
 }
+
+// One server step, with the *_inside hooks of args.stage when iterArgs is set
+static void apply_step(HEAANContext& ctx, const CampaignArgs& args, Ciphertext& c,
+                       const ServerStep& step, const std::optional<IterationArgs>& iterArgs)
+{
+    const uint32_t op_depth = args.op_depth;
+    const uint32_t op_step = args.op_step;
+    Ciphertext& c_clean = ctx.cClean;
+    ZZX& plain_clean = ctx.mxPlainMul;
+
+    switch (step.op) {
+    case ServerOp::Add:
+        if(iterArgs && args.stage == "add_inside" && step.depth == op_depth){
+            c = ctx.scheme.addBitFlip(c, c_clean, op_step, iterArgs->coeff, iterArgs->bit);
+        }else {
+            c = ctx.scheme.add(c, c_clean);
+        }
+        break;
+    case ServerOp::PlainMul:
+        c = ctx.scheme.multByPoly(c, plain_clean, args.logDelta);
+        break;
+    case ServerOp::Mul:
+        if(iterArgs && args.stage == "mul_inside" && step.depth == op_depth){
+            c = ctx.scheme.multBitFlip(c, c_clean, op_step, iterArgs->coeff, iterArgs->bit);
+        }else {
+            c = ctx.scheme.mult(c, c_clean);
+        }
+        if(iterArgs && args.stage == "rescale_inside" && step.depth == op_depth){
+            ctx.scheme.reScaleByAndEqualBitFlip(c, args.logDelta, op_step, iterArgs->coeff, iterArgs->bit);
+        }else {
+            ctx.scheme.reScaleByAndEqual(c, args.logDelta);
+        }
+        break;
+    case ServerOp::Rot: {
+        int32_t rotIndex = static_cast<int32_t>(1ULL << (args.doRot - 1));
+        if(iterArgs && args.stage == "rot_inside"){
+            c = ctx.scheme.leftRotateFastBitFlip(c, rotIndex, op_step, iterArgs->coeff, iterArgs->bit);
+        }else {
+            c = ctx.scheme.leftRotateFast(c, rotIndex);
+        }
+        break;
+    }
+    }
+}
+
+// First step the iteration has to run: the step args.stage faults, all of
+// them for client-side input faults, none when the fault comes after the
+// server (or there is no fault). Without snapshots everything runs.
+static size_t resume_step(const HEAANContext& ctx, const CampaignArgs& args,
+                          const std::vector<ServerStep>& steps,
+                          const std::optional<IterationArgs>& iterArgs)
+{
+    if (ctx.opStates.empty())
+        return 0;
+    if (!iterArgs)
+        return steps.size();
+
+    ServerOp op;
+    if (args.stage == "add_inside")
+        op = ServerOp::Add;
+    else if (args.stage == "mul_inside" || args.stage == "rescale_inside")
+        op = ServerOp::Mul;
+    else if (args.stage == "rot_inside")
+        op = ServerOp::Rot;
+    else if (args.stage == "decrypt_c0" || args.stage == "decrypt_c1" ||
+             args.stage == "decode" || args.stage.rfind("boot_", 0) == 0)
+        return steps.size();
+    else
+        return 0;
+
+    for (size_t k = 0; k < steps.size(); ++k)
+        if (steps[k].op == op && (op == ServerOp::Rot || steps[k].depth == args.op_depth))
+            return k;
+    return steps.size(); // op_depth out of range: the hook never fires
+}
+
+// Fills ctx.opStates from the store, computing and storing what is missing
+static void prepare_snapshots(HEAANContext& ctx, const CampaignArgs& args)
+{
+    SnapshotStore store(args.results_dir + "/snapshots");
+    const auto steps = server_steps(args);
+    const std::string prefix = snapshot_prefix(ctx, args);
+    const long N = ctx.cc.N;
+
+    // State 0 carries cClean as well, the operand of add and mul
+    const std::string inputDesc = snapshot_description(prefix, args, steps, 0);
+    if (auto snap = store.load(inputDesc)) {
+        SnapshotReader r = snap->reader();
+        ctx.cInput = get_cipher(r);
+        ctx.cClean = get_cipher(r);
+    } else {
+        ctx.cInput = ctx.scheme.encryptMsg(ctx.plainInput, ctx.seed);
+        ctx.cClean = ctx.scheme.encryptMsg(ctx.plainInput, ctx.seed);
+        SnapshotWriter w;
+        put_cipher(w, ctx.cInput, N);
+        put_cipher(w, ctx.cClean, N);
+        store.store(inputDesc, w);
+    }
+
+    ctx.opStates.assign(1, ctx.cInput);
+    for (size_t k = 1; k <= steps.size(); ++k) {
+        const std::string desc = snapshot_description(prefix, args, steps, k);
+        if (auto snap = store.load(desc)) {
+            SnapshotReader r = snap->reader();
+            ctx.opStates.push_back(get_cipher(r));
+            continue;
+        }
+        Ciphertext c = ctx.opStates.back();
+        apply_step(ctx, args, c, steps[k - 1], std::nullopt);
+        SnapshotWriter w;
+        put_cipher(w, c, N);
+        store.store(desc, w);
+        ctx.opStates.push_back(std::move(c));
+    }
+}
 IterationResult run_iteration(
     BackendContext* bctx,
     const CampaignArgs& args,
     std::optional<IterationArgs> iterArgs
     )
 {
-    uint32_t op_depth = args.op_depth;
     uint32_t op_step = args.op_step;
 
     auto& ctx = static_cast<HEAANContext&>(*bctx);
 
-    auto baseInput = ctx.baseInput.data();
-    auto baseSize  = ctx.baseInput.size();
-    auto baseInputComplex = ctx.baseInputComplex.data();
     uint32_t amountBits = args.amountBits;
 
-    if(args.isComplex){
-        baseSize = ctx.baseInputComplex.size();
-    }
-
-    Plaintext plain;
-    Plaintext plain_clean;
-
-    if(args.isComplex>0){
-        plain = ctx.scheme.encode(
-            baseInputComplex,
-            baseSize,
-            args.logDelta,
-            args.logQ
-        );
-    } else{
-        plain = ctx.scheme.encode(
-            baseInput,
-            baseSize,
-            args.logDelta,
-            args.logQ
-        );
-    }
+    const auto steps = server_steps(args);
+    const size_t start = resume_step(ctx, args, steps, iterArgs);
 
-    if (iterArgs && args.stage == "encode") {
+    // Encoding and encryption are deterministic under ctx.seed, so only an
+    // encode-stage flip needs a fresh encryption.
+    Ciphertext c;
+    if (start > 0) {
+        c = ctx.opStates[start];
+    } else if (iterArgs && args.stage == "encode") {
+        Plaintext plain = ctx.plainInput;
         flipBit(amountBits, plain.mx, iterArgs->coeff, iterArgs->bit);
+        c = ctx.scheme.encryptMsg(plain, ctx.seed);
+    } else {
+        c = ctx.cInput;
     }
 
-    Ciphertext c = ctx.scheme.encryptMsg(plain, ctx.seed);
-    Ciphertext c_clean;
-    if(args.doAdd || args.doMul){
-        if(args.isComplex){
-            plain_clean =  ctx.scheme.encode(baseInputComplex,
-                                baseSize,
-                                args.logDelta,
-                                args.logQ
-                            );
-        } else {
-            plain_clean =  ctx.scheme.encode(baseInput,
-                                baseSize,
-                                args.logDelta,
-                                args.logQ
-                            );
-        }
-        c_clean = ctx.scheme.encryptMsg(plain_clean, ctx.seed);
-    }
-
-    if(args.doPlainMul){
-        if(args.isComplex){
-            plain_clean =  ctx.cc.encode(baseInputComplex, baseSize, args.logDelta);
-        } else {
-            plain_clean =  ctx.cc.encode(baseInput, baseSize, args.logDelta);
-        }
-    }
     if (iterArgs) {
         if (args.stage == "encrypt_c0") {
             flipBit(amountBits, c.bx, iterArgs->coeff, iterArgs->bit);
@@ -172,39 +351,8 @@ IterationResult run_iteration(
     }
 
     // Server Side
-    for (uint32_t i = 0; i < args.doAdd; ++i) {
-        if(iterArgs && args.stage == "add_inside" && i == op_depth){
-            c = ctx.scheme.addBitFlip(c, c_clean, op_step, iterArgs->coeff, iterArgs->bit);
-        }else {
-            c = ctx.scheme.add(c, c_clean);
-        }
-    }
-
-    for (uint32_t i = 0; i < args.doPlainMul; ++i) {
-        c = ctx.scheme.multByPoly(c, plain_clean.mx, args.logDelta);
-    }
-
-    for (uint32_t i = 0; i < args.doMul; ++i) {
-        if(iterArgs && args.stage == "mul_inside" && i == op_depth){
-            c = ctx.scheme.multBitFlip(c, c_clean, op_step, iterArgs->coeff, iterArgs->bit);
-        }else {
-                c = ctx.scheme.mult(c, c_clean);
-        }
-        if(iterArgs && args.stage == "rescale_inside" && i == op_depth){
-            ctx.scheme.reScaleByAndEqualBitFlip(c, args.logDelta, op_step, iterArgs->coeff, iterArgs->bit);
-        }else {
-                ctx.scheme.reScaleByAndEqual(c, args.logDelta);
-        }
-    }
-
-    if(args.doRot>0){
-        int32_t rotIndex = static_cast<int32_t>(1ULL << (args.doRot - 1));
-        if(iterArgs && args.stage == "rot_inside"){
-            c = ctx.scheme.leftRotateFastBitFlip(c, rotIndex, op_step, iterArgs->coeff, iterArgs->bit);
-        }else {
-            c = ctx.scheme.leftRotateFast(c, rotIndex);
-        }
-    }
+    for (size_t k = start; k < steps.size(); ++k)
+        apply_step(ctx, args, c, steps[k], iterArgs);
 
     // Back to client side
     if (iterArgs) {
@@ -233,18 +381,14 @@ IterationResult run_iteration(
         flipBit(amountBits, decrypt_plain.mx, iterArgs->coeff, iterArgs->bit);
     }
 
-    complex<double>* decoded = ctx.scheme.decode(decrypt_plain);
-
     IterationResult res;
     const size_t slots = 1u << args.logSlots;
-    if(args.isComplex>0){
-        res.values.resize(2*slots);
-
-        for (size_t i = 0; i < slots; i++) {
-            res.values[i] = decoded[i].real();
-            res.values[i+slots] = decoded[i].imag();
-        }
+    ctx.decoded.resize(slots);
+    auto decoded = ctx.decoded.data();
+    decodeSlots(ctx.cc, decrypt_plain, slots, decoded);
 
+    if(args.isComplex>0){
+        res.complexValues.assign(decoded, decoded + slots);
     } else {
         res.values.resize(slots);
 
@@ -254,13 +398,47 @@ IterationResult run_iteration(
 
     }
 
-    delete[] decoded;
-
     res.detected = false;
 
     return res;
 }
 
+BitflipResult evaluate_flip(
+    BackendContext* ctx,
+    const CampaignArgs& args,
+    const IterationResult& golden,
+    const IterationArgs& iterArgs)
+{
+    const size_t slots = (size_t)(1 << args.logSlots);
+    IterationResult res = run_iteration(ctx, args, iterArgs);
+
+    CKKSAccuracyMetrics exp_metrics;
+    SlotErrorStats slot_stats;
+    double mod_error = std::numeric_limits<double>::quiet_NaN();
+    double phase_error = mod_error;
+    if (args.isComplex > 0) {
+        auto complex_metrics = EvaluateCKKSAccuracyComplex(
+            golden.complexValues, res.complexValues, slots);
+        exp_metrics = complex_metrics.base;
+        slot_stats  = complex_metrics.stats;
+        mod_error   = complex_metrics.linf_mod_error;
+        phase_error = complex_metrics.linf_phase_error;
+    } else {
+        exp_metrics = EvaluateCKKSAccuracy(golden.values, res.values);
+        slot_stats  = categorize_slots_relative(golden.values, res.values, slots);
+    }
+    BitflipResult r{};
+    r.limb = iterArgs.limb;
+    r.coeff = iterArgs.coeff;
+    r.bit = iterArgs.bit;
+    r.norm2 = exp_metrics.l2_rel_error;     // ||error||_2 / ||golden||_2
+    r.rel_error = exp_metrics.linf_rel_error;
+    r.is_sdc = res.detected;
+    r.stats = slot_stats;
+    r.mod_error = mod_error;
+    r.phase_error = phase_error;
+    return r;
+}
 
 void destroy_campaign(BackendContext* ctx) {
     delete ctx;
@@ -275,34 +453,16 @@ IterationResult run_NN(
     auto& ctx = static_cast<HEAANContext&>(*bctx);
     uint32_t amountBits = args.amountBits;
 
-    Plaintext plain = ctx.scheme.encode(
-        ctx.baseInput.data(),
-        ctx.baseInput.size(),
-        args.logDelta,
-        args.logQ
-    );
-    Plaintext plain_clean;
+    Ciphertext c;
     if (iterArgs && args.stage == "encode") {
+        Plaintext plain = ctx.plainInput;
         flipBit(amountBits, plain.mx, iterArgs->coeff, iterArgs->bit);
+        c = ctx.scheme.encryptMsg(plain, ctx.seed);
+    } else {
+        c = ctx.cInput;
     }
-
-    Ciphertext c = ctx.scheme.encryptMsg(plain, ctx.seed);
-    Ciphertext c_clean;
-    if(args.doAdd || args.doMul){
-        plain_clean =  ctx.scheme.encode(ctx.baseInput.data(),
-                            ctx.baseInput.size(),
-                            args.logDelta,
-                            args.logQ
-                        );
-        c_clean = ctx.scheme.encryptMsg(plain_clean, ctx.seed);
-    }
-
-    if(args.doPlainMul){
-        plain_clean =  ctx.cc.encode(ctx.baseInput.data(),
-                            ctx.baseInput.size(),
-                            args.logDelta
-                        );
-    }
+    Ciphertext& c_clean = ctx.cClean;
+    ZZX& plain_clean = ctx.mxPlainMul;
 
     if (iterArgs) {
         if (args.stage == "encrypt_c0") {
@@ -316,7 +476,7 @@ IterationResult run_NN(
         c = ctx.scheme.add(c, c_clean);
 
     for (uint32_t i = 0; i < args.doPlainMul; ++i) {
-        c = ctx.scheme.multByPoly(c, plain_clean.mx, args.logDelta);
+        c = ctx.scheme.multByPoly(c, plain_clean, args.logDelta);
     }
 
     for (uint32_t i = 0; i < args.doMul; ++i) {
@@ -344,18 +504,16 @@ IterationResult run_NN(
             flipBit(amountBits, decrypt_plain.mx, iterArgs->coeff, iterArgs->bit);
     }
 
-    complex<double>* decoded = ctx.scheme.decode(decrypt_plain);
-
     IterationResult res;
     const size_t slots = 1u << args.logSlots;
     res.values.resize(slots);
+    ctx.decoded.resize(slots);
+    decodeSlots(ctx.cc, decrypt_plain, slots, ctx.decoded.data());
 
     for (size_t i = 0; i < slots; i++) {
-        res.values[i] = decoded[i].real();
+        res.values[i] = ctx.decoded[i].real();
     }
 
-    delete[] decoded;
-
     res.detected = false;
 
     return res;
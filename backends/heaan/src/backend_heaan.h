@@ -0,0 +1,116 @@
+#pragma once
+#include "HEAAN.h"
+#include <NTL/ZZ.h>
+#include <cstdint>
+#include <vector>
+#include <complex>
+#include "backend_interface.h"
+#include "utils_ckks.h"
+
+struct HEAANContext : BackendContext {
+    Context cc;
+    SecretKey sk;
+    Scheme scheme;
+
+    std::vector<double> baseInput;
+    std::vector<double> goldenOutput;
+    std::vector<std::complex<double>> baseInputComplex;
+    std::vector<std::complex<double>> goldenOutputComplex;
+    NTL::ZZ seed;
+
+    // Clean encodings and ciphertexts built once in setup_campaign;
+    // run_iteration hands out copies instead of re-encoding/encrypting.
+    Plaintext plainInput;
+    ZZX mxPlainMul;
+    Ciphertext cInput;
+    Ciphertext cClean;
+
+    // --snapshots: clean ciphertext after k server ops (opStates[0] = cInput),
+    // loaded from or written to the snapshot store in setup_campaign. A fault
+    // in op k starts from opStates[k] instead of redoing ops 0..k-1.
+    std::vector<Ciphertext> opStates;
+
+    // Reused by run_iteration so decode does not allocate per flip
+    std::vector<std::complex<double>> decoded;
+
+    HEAANContext(
+        uint32_t logN,
+        uint32_t logQ,
+        uint32_t h,
+        uint64_t seed_
+    )
+        : cc(logN, logQ)
+        , sk(logN, h)
+        , scheme(sk, cc)   // ← ahora sí
+        , seed(NTL::ZZ(seed_))
+    {}
+
+    HEAANContext(const HEAANContext&) = delete;
+    HEAANContext& operator=(const HEAANContext&) = delete;
+};
+
+// Same coefficient extraction as Context::decode, without the fft and
+// without allocating: u[i] = m_{i*gap} + i*m_{i*gap+Nh}, scaled down.
+inline void extractSlotCoeffs(Context& context, const Plaintext& pt,
+                              std::vector<std::complex<double>>& u)
+{
+    const long slots = pt.slots;
+    const long gap = context.Nh / slots;
+    const ZZ& q = context.qpowvec[pt.logq];
+    ZZ tmp;
+
+    u.resize(slots);
+    for (long i = 0, idx = 0; i < slots; ++i, idx += gap) {
+        rem(tmp, coeff(pt.mx, idx), q);
+        if (NumBits(tmp) == pt.logq) tmp -= q;
+        u[i].real(EvaluatorUtils::scaleDownToReal(tmp, pt.logp));
+
+        rem(tmp, coeff(pt.mx, idx + context.Nh), q);
+        if (NumBits(tmp) == pt.logq) tmp -= q;
+        u[i].imag(EvaluatorUtils::scaleDownToReal(tmp, pt.logp));
+    }
+}
+
+// Decodes only the slots in slotIdx into out[0..slotIdx.size()).
+// Few slots are evaluated directly (pruned fft), otherwise the full
+// fftSpecial runs on a thread-local scratch buffer.
+inline void decodeSlots(Context& context, const Plaintext& pt,
+                        const std::vector<size_t>& slotIdx,
+                        std::complex<double>* out)
+{
+    static thread_local std::vector<std::complex<double>> u;
+    extractSlotCoeffs(context, pt, u);
+
+    const size_t slots = static_cast<size_t>(pt.slots);
+    size_t logSlots = 0;
+    while ((size_t(1) << logSlots) < slots) logSlots++;
+
+    if (slotIdx.size() <= logSlots) {
+        evaluate_slots(u.data(), slots, slotIdx, out);
+        return;
+    }
+
+    context.fftSpecial(u.data(), pt.slots);
+    for (size_t k = 0; k < slotIdx.size(); ++k)
+        out[k] = u[slotIdx[k]];
+}
+
+// Decodes the first `count` slots into out (caller buffer of size >= count).
+inline void decodeSlots(Context& context, const Plaintext& pt,
+                        size_t count, std::complex<double>* out)
+{
+    static thread_local std::vector<std::complex<double>> u;
+    size_t logSlots = 0;
+    while ((size_t(1) << logSlots) < static_cast<size_t>(pt.slots)) logSlots++;
+
+    if (count <= logSlots) {
+        std::vector<size_t> idx(count);
+        for (size_t i = 0; i < count; ++i) idx[i] = i;
+        decodeSlots(context, pt, idx, out);
+        return;
+    }
+
+    extractSlotCoeffs(context, pt, u);
+    context.fftSpecial(u.data(), pt.slots);
+    std::copy(u.begin(), u.begin() + count, out);
+}
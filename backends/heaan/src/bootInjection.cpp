@@ -25,16 +25,18 @@ int main(int argc, char* argv[]) {
     std::cout << "Computing golden output..." << std::endl;
 
     IterationResult goldenCKKS_output = run_iteration(ctx, args);
-    std::vector<double> goldenOutput;
-
-    if(args.isComplex>0){
-        goldenOutput = get_reference_output_complex(ctx);
+    const bool isComplex = args.isComplex > 0;
+
+    CKKSAccuracyMetrics baseline_metrics;
+    if(isComplex){
+        baseline_metrics = EvaluateCKKSAccuracyComplex(
+            get_reference_output_complex(ctx),
+            goldenCKKS_output.complexValues,
+            slots).base;
     } else {
-        goldenOutput = get_reference_output(ctx);
+        baseline_metrics = EvaluateCKKSAccuracy(get_reference_output(ctx), goldenCKKS_output.values);
     }
 
-    CKKSAccuracyMetrics baseline_metrics = EvaluateCKKSAccuracy(goldenOutput, goldenCKKS_output.values);
-
 
     if(AcceptCKKSResult(baseline_metrics))
     {
@@ -45,7 +47,7 @@ int main(int argc, char* argv[]) {
 
         std::cout << "\n=== Starting Campaign " << campaign_id << " ===" << std::endl;
 
-        CampaignLogger logger(campaign_id, args.results_dir + "/data");
+        CampaignLogger logger(campaign_id, args.results_dir + "/data", 10000, RecordOptions::from(args));
 
         std::cout << "Campaign " << campaign_id << " registered" << std::endl;
 
@@ -81,17 +83,32 @@ int main(int argc, char* argv[]) {
 
                     IterationResult res = run_iteration(ctx, args, iterArgs);
 
-                    CKKSAccuracyMetrics  exp_metrics = EvaluateCKKSAccuracy(goldenCKKS_output.values, res.values);
-
-                    auto slot_stats = categorize_slots_relative(goldenCKKS_output.values, res.values, slots);
-                    logger.log(iterArgs.limb,
-                            iterArgs.coeff,
-                            iterArgs.bit,
-                            exp_metrics.l2_rel_error,     // ||error||_2 / ||golden||_2
-                            exp_metrics.linf_rel_error,
-                            res.detected,
-                            slot_stats
-                        );
+                    CKKSAccuracyMetrics exp_metrics;
+                    SlotErrorStats slot_stats;
+                    double mod_error = std::numeric_limits<double>::quiet_NaN();
+                    double phase_error = mod_error;
+                    if(isComplex){
+                        auto complex_metrics = EvaluateCKKSAccuracyComplex(
+                            goldenCKKS_output.complexValues, res.complexValues, slots);
+                        exp_metrics = complex_metrics.base;
+                        slot_stats  = complex_metrics.stats;
+                        mod_error   = complex_metrics.linf_mod_error;
+                        phase_error = complex_metrics.linf_phase_error;
+                    } else {
+                        exp_metrics = EvaluateCKKSAccuracy(goldenCKKS_output.values, res.values);
+                        slot_stats  = categorize_slots_relative(goldenCKKS_output.values, res.values, slots);
+                    }
+                    BitflipResult r{};
+                    r.limb = iterArgs.limb;
+                    r.coeff = iterArgs.coeff;
+                    r.bit = iterArgs.bit;
+                    r.norm2 = exp_metrics.l2_rel_error;     // ||error||_2 / ||golden||_2
+                    r.rel_error = exp_metrics.linf_rel_error;
+                    r.is_sdc = res.detected;
+                    r.stats = slot_stats;
+                    r.mod_error = mod_error;
+                    r.phase_error = phase_error;
+                    logger.log(r);
 
                     norms.push_back(exp_metrics.l2_rel_error);
                 }
@@ -107,12 +124,21 @@ int main(int argc, char* argv[]) {
 
         registry.register_end({campaign_id, logger.total(), logger.sdc(), mins, l2_P95, l2_P99, timestamp_now()});
     } else {
-        printBaselineComparison(
-            args,
-            goldenOutput,
-            goldenCKKS_output.values,
-            baseline_metrics
-        );
+        if(isComplex){
+            printBaselineComparison(
+                args,
+                get_reference_output_complex(ctx),
+                goldenCKKS_output.complexValues,
+                baseline_metrics
+            );
+        } else {
+            printBaselineComparison(
+                args,
+                get_reference_output(ctx),
+                goldenCKKS_output.values,
+                baseline_metrics
+            );
+        }
         return 1;
     }
 
@@ -1,6 +1,7 @@
 #include "campaign_helper.h"
 #include "campaign_logger.h"
-#include "campaign_registry.h"
+#include "campaign_exhaustive.h"
+#include "campaign_forkserver.h"
 #include "backend_interface.h"
 #include "utils_ckks.h"
 
@@ -17,102 +18,55 @@ int main(int argc, char* argv[]) {
         args.print();
     }
 
+    // Forked workers only get the main thread: no OpenMP pool before fork
+    if (args.workers > 0)
+        prepare_fork_server();
+
     BackendContext* ctx = setup_campaign(args);
     size_t slots =  (size_t)(1 << args.logSlots);
     std::cout << "Computing golden output..." << std::endl;
 
     IterationResult goldenCKKS_output = run_iteration(ctx, args);
-    std::vector<double> goldenOutput;
-
-    if(args.isComplex>0){
-        goldenOutput = get_reference_output_complex(ctx);
+    const bool isComplex = args.isComplex > 0;
+
+    CKKSAccuracyMetrics baseline_metrics;
+    if(isComplex){
+        baseline_metrics = EvaluateCKKSAccuracyComplex(
+            get_reference_output_complex(ctx),
+            goldenCKKS_output.complexValues,
+            slots).base;
     } else {
-        goldenOutput = get_reference_output(ctx);
+        baseline_metrics = EvaluateCKKSAccuracy(get_reference_output(ctx), goldenCKKS_output.values);
     }
 
-    CKKSAccuracyMetrics baseline_metrics = EvaluateCKKSAccuracy(goldenOutput, goldenCKKS_output.values);
-
 
     if(AcceptCKKSResult(baseline_metrics))
     {
         try{
-            CampaignRegistry registry(args);
-            std::cout << "\n=== Registring Campaign "<< std::endl;
-            uint32_t campaign_id = registry.campaign_id;
-        //    registry.register_start({campaign_id, args, ""});
-
-            std::cout << "\n=== Starting Campaign " << campaign_id << " ===" << std::endl;
-
-            CampaignLogger logger(campaign_id, args.results_dir + "/data");
-
-            std::cout << "Campaign " << campaign_id << " registered" << std::endl;
-
-
-            std::cout << "\nStarting bit flip campaign..." << std::endl;
-
-            // Calcular total esperado para progress
-            uint32_t N = 1 << args.logN;
-            size_t num_coeffs = N;
-            size_t bits_per_coeff = args.bitPerCoeff;
-            size_t total_expected =  num_coeffs * bits_per_coeff ;
-
-            std::vector<double> norms;
-            norms.reserve(total_expected);
-            std::cout << "Expected bit flips: " << total_expected << std::endl;
-
-
-            auto start_time = std::chrono::high_resolution_clock::now();
-            for (size_t coeff = 0; coeff<num_coeffs; coeff++)
-            {
-                for(size_t bit=0; bit<bits_per_coeff; bit++)
-                {
-                    IterationArgs iterArgs(0, coeff, bit);
-                    if(args.existing_policy == ExistingCampaignPolicy::Reuse){
-                        if (logger.contains(iterArgs))
-                        {
-                            std::cout << "Skipping already computed iteration\n";
-                        }
-                    }
-                    else{
-                        IterationResult res = run_iteration(ctx, args, iterArgs);
-
-                        CKKSAccuracyMetrics  exp_metrics = EvaluateCKKSAccuracy(goldenCKKS_output.values, res.values);
-
-                        auto slot_stats = categorize_slots_relative(goldenCKKS_output.values, res.values, slots);
-                        logger.log(iterArgs.limb,
-                                iterArgs.coeff,
-                                iterArgs.bit,
-                                exp_metrics.l2_rel_error,     // ||error||_2 / ||golden||_2
-                                exp_metrics.linf_rel_error,
-                                res.detected,
-                                slot_stats
-                            );
-
-                        norms.push_back(exp_metrics.l2_rel_error);
-                    }
-                }
-            }
-            std::sort(norms.begin(), norms.end());
-            double l2_P95 = percentile(norms, 0.95);
-            double l2_P99 = percentile(norms, 0.99);
-            auto end_time = std::chrono::high_resolution_clock::now();
-            std::chrono::seconds duration = std::chrono::duration_cast<std::chrono::seconds>(end_time - start_time);
-            auto minutes = std::chrono::duration_cast<std::chrono::minutes>(duration);
-            uint64_t mins = minutes.count();
-
-            registry.register_end({campaign_id, logger.total(), logger.sdc(), mins, l2_P95, l2_P99, timestamp_now()});
+            run_exhaustive_campaign(args, [&](const IterationArgs& iterArgs) {
+                return evaluate_flip(ctx, args, goldenCKKS_output, iterArgs);
+            });
         }
         catch (const std::runtime_error& e) {
             std::cerr << e.what() << '\n';
             return 0;
         }
     } else {
-        printBaselineComparison(
-            args,
-            goldenOutput,
-            goldenCKKS_output.values,
-            baseline_metrics
-        );
+        if(isComplex){
+            printBaselineComparison(
+                args,
+                get_reference_output_complex(ctx),
+                goldenCKKS_output.complexValues,
+                baseline_metrics
+            );
+        } else {
+            printBaselineComparison(
+                args,
+                get_reference_output(ctx),
+                goldenCKKS_output.values,
+                baseline_metrics
+            );
+        }
         return 1;
     }
 
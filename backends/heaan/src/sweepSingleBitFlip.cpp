@@ -0,0 +1,90 @@
+#include "campaign_helper.h"
+#include "campaign_logger.h"
+#include "campaign_exhaustive.h"
+#include "campaign_forkserver.h"
+#include "campaign_sweep.h"
+#include "backend_interface.h"
+#include "utils_ckks.h"
+
+// Runs the exhaustiveSingleBitFlip rows of a run_campaign.py config in one
+// process: rows that only differ in stage/op_step/op_depth share the keys,
+// the golden output and the cached ciphertexts of one setup_campaign. Each
+// row runs the same loop as exhaustiveSingleBitFlip (run_exhaustive_campaign).
+
+ExistingCampaignPolicy existing_policy = ExistingCampaignPolicy::ReuseStrict;
+
+static void apply_overrides(CampaignArgs& args)
+{
+    args.library = "heaan";
+    args.isExhaustive = true;
+    args.existing_policy = existing_policy;
+    args.mult_depth = 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <config.csv>\n";
+        return 1;
+    }
+
+    auto groups = load_sweep_groups(argv[1], "heaan", "exhaustiveSingleBitFlip");
+    std::cout << "Sweep: " << groups.size() << " groups" << std::endl;
+
+    int failed = 0;
+    for (const auto& group : groups) {
+        CampaignArgs groupArgs = sweep_row_args(group.rows.front(), argv[0]);
+        apply_overrides(groupArgs);
+        if (groupArgs.verbose) {
+            groupArgs.print();
+        }
+
+        // Forked workers only get the main thread: no OpenMP pool before fork
+        if (groupArgs.workers > 0)
+            prepare_fork_server();
+
+        BackendContext* ctx = setup_campaign(groupArgs);
+        const size_t slots = (size_t)(1 << groupArgs.logSlots);
+        const bool isComplex = groupArgs.isComplex > 0;
+
+        // The golden run has no flip, so it is the same for every row.
+        IterationResult goldenCKKS_output = run_iteration(ctx, groupArgs);
+        CKKSAccuracyMetrics baseline_metrics;
+        if (isComplex) {
+            baseline_metrics = EvaluateCKKSAccuracyComplex(
+                get_reference_output_complex(ctx),
+                goldenCKKS_output.complexValues,
+                slots).base;
+        } else {
+            baseline_metrics = EvaluateCKKSAccuracy(get_reference_output(ctx), goldenCKKS_output.values);
+        }
+
+        if (!AcceptCKKSResult(baseline_metrics)) {
+            if (isComplex) {
+                printBaselineComparison(groupArgs, get_reference_output_complex(ctx),
+                                        goldenCKKS_output.complexValues, baseline_metrics);
+            } else {
+                printBaselineComparison(groupArgs, get_reference_output(ctx),
+                                        goldenCKKS_output.values, baseline_metrics);
+            }
+            failed += group.rows.size();
+            destroy_campaign(ctx);
+            continue;
+        }
+
+        for (const auto& row : group.rows) {
+            CampaignArgs args = sweep_row_args(row, argv[0]);
+            apply_overrides(args);
+            std::cout << "\n=== Run " << row.run_id << std::endl;
+            try {
+                run_exhaustive_campaign(args, [&](const IterationArgs& iterArgs) {
+                    return evaluate_flip(ctx, args, goldenCKKS_output, iterArgs);
+                });
+            } catch (const std::runtime_error& e) {
+                std::cerr << row.run_id << ": " << e.what() << '\n';
+            }
+        }
+        destroy_campaign(ctx);
+    }
+
+    return failed > 0 ? 1 : 0;
+}
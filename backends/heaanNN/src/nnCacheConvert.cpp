@@ -0,0 +1,33 @@
+#include "nn_cache.h"
+#include <chrono>
+#include <iostream>
+
+// One-time conversion of the MNIST/weight CSVs into the binary cache the
+// NN drivers map at startup: nnCacheConvert [dataDir] [outFile]
+const size_t INPUT_DIM = 784;
+const size_t HIDDEN_DIM = 64;
+const size_t OUTPUT_DIM = 10;
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "../NN_config/data/";
+    if (!path.empty() && path.back() != '/')
+        path += '/';
+    std::string out = argc > 2 ? argv[2] : path + NN_CACHE_FILE;
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        size_t rows = writeNNCacheFromCSV(out,
+            path + "mnist_train.csv",
+            path + "weights/W1.csv", path + "weights/b1.csv",
+            path + "weights/W2.csv", path + "weights/b2.csv",
+            INPUT_DIM, HIDDEN_DIM, OUTPUT_DIM);
+
+        std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+        std::cout << "Wrote " << rows << " rows to " << out
+                  << " in " << t.count() << " s" << std::endl;
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -39,16 +39,27 @@ int main(int argc, char* argv[]) {
     if(verbose)
         cout << "Initializing HE..." << endl;
 
-    HEEnv he(logN, logQ, h);
+    HEEnv he(logN, logQ, h, logSlots);
+    // The packed forward also needs its baby/giant/stride rotations
+    if(args.nnPacked)
+        he.addRotKeys(packedRotations(packedLayout(slots, HIDDEN_DIM, OUTPUT_DIM)));
+
+    // Binary cache written by nnCacheConvert, the CSVs otherwise
+    auto cache = NNCache::openIfExists(path + NN_CACHE_FILE);
+    if(cache && (cache->input() != INPUT_DIM || cache->hidden() != HIDDEN_DIM ||
+                 cache->output() != OUTPUT_DIM)){
+        cerr << "NN cache " << cache->path() << " does not match the network dimensions\n";
+        return 1;
+    }
 
     if(verbose)
-        cout << "Loading weights..." << endl;
+        cout << "Loading weights" << (cache ? " from cache" : "") << "..." << endl;
 
-    auto W1  = loadCSVMatrix(path+"weights/W1.csv", HIDDEN_DIM, INPUT_DIM);
-    auto b1  = loadCSVVector(path+"weights/b1.csv", HIDDEN_DIM);
+    auto W1  = cache ? cache->W1() : loadCSVMatrix(path+"weights/W1.csv", HIDDEN_DIM, INPUT_DIM);
+    auto b1  = cache ? cache->b1() : loadCSVVector(path+"weights/b1.csv", HIDDEN_DIM);
 
-    auto W2  = loadCSVMatrix(path+"weights/W2.csv", OUTPUT_DIM, HIDDEN_DIM);
-    auto b2  = loadCSVVector(path+"weights/b2.csv", OUTPUT_DIM);
+    auto W2  = cache ? cache->W2() : loadCSVMatrix(path+"weights/W2.csv", OUTPUT_DIM, HIDDEN_DIM);
+    auto b2  = cache ? cache->b2() : loadCSVVector(path+"weights/b2.csv", OUTPUT_DIM);
 
     assert(W1[0].size() == INPUT_DIM);
     assert(W2[0].size() == HIDDEN_DIM);
@@ -56,8 +67,9 @@ int main(int argc, char* argv[]) {
     if(verbose)
         cout << "Encoding weights..." << endl;
 
-    EncodedWeights encoded =
-        encodeWeights(he, W1, b1, W2, b2, slots, logP);
+    EncodedWeights encoded = args.nnPacked
+        ? encodeWeightsPacked(he, W1, b1, W2, b2, slots, logP, cache.get())
+        : encodeWeights(he, W1, b1, W2, b2, slots, logP, 0, cache.get());
 
     if(verbose)
         cout << "Ready for inference.\n" << endl;
@@ -65,12 +77,14 @@ int main(int argc, char* argv[]) {
     vector<double> vals;
     size_t targetValue;
 
-    bool ok = loadMnistNormRowByIndex(
-        path+"mnist_train.csv",
-        targetRow,
-        targetValue,
-        vals
-    );
+    bool ok = cache
+        ? cache->row(targetRow, targetValue, vals)
+        : loadMnistNormRowByIndex(
+            path+"mnist_train.csv",
+            targetRow,
+            targetValue,
+            vals
+        );
 
     if(!ok){
         cerr << "Error loading MNIST image\n";
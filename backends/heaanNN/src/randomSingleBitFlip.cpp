@@ -14,79 +14,58 @@ const std::string path = "../NN_config/data/";
 size_t NUM_BITFLIPS = 50;
 ExistingCampaignPolicy existing_policy = ExistingCampaignPolicy::ReuseStrict;
 
-int main(int argc, char* argv[]) {
-
-    std::cout << "\n=== Starting Campaign "<< std::endl;
-    CampaignArgs args = parse_arguments(argc, argv);
-    args.library = "heaanNN";
-    args.isExhaustive= false;
-    args.mult_depth = 0;
-    args.existing_policy = existing_policy;
-
-    if (args.verbose) {
-        args.print();
-    }
-
-
-    long logQ = args.logQ;
-    long logP = args.logDelta;
+// Campaign for images args.seed .. args.seed+batch-1 against already
+// encoded weights. Returns 1 when the image cannot be loaded or the clean
+// network mispredicts it.
+static int runImageCampaign(HEEnv& he, EncodedWeights& encoded, const NNCache* cache,
+                            CampaignArgs args, size_t batch)
+{
+    size_t targetRow = args.seed;
+    size_t verbose = args.verbose;
     long logN = args.logN;
-    long logSlots = args.logSlots;
-    long slots = 1 << logSlots;
-    long h = 64;
-
-    size_t targetRow =  args.seed;
-    size_t verbose =  args.verbose;
-
-    assert(INPUT_DIM <= slots);
-    if(verbose)
-        std::cout << "Initializing HE..." << std::endl;
-
-    HEEnv he(logN, logQ, h);
-
-    if(verbose)
-        std::cout << "Loading weights..." << std::endl;
-
-    auto W1  = loadCSVMatrix(path+"weights/W1.csv", HIDDEN_DIM, INPUT_DIM);
-    auto b1  = loadCSVVector(path+"weights/b1.csv", HIDDEN_DIM);
-
-    auto W2  = loadCSVMatrix(path+"weights/W2.csv", OUTPUT_DIM, HIDDEN_DIM);
-    auto b2  = loadCSVVector(path+"weights/b2.csv", OUTPUT_DIM);
-    assert(W1[0].size() == INPUT_DIM);
-    assert(W2[0].size() == HIDDEN_DIM);
-
-
-
-    if(verbose)
-        std::cout << "Encoding weights..." << std::endl;
-
-    EncodedWeights encoded =
-        encodeWeights(he, W1, b1, W2, b2, slots, logP);
-
-    if(verbose)
-        std::cout << "Ready for inference.\n" << std::endl;
 
-    vector<double> vals;
-    size_t targetValue;
-
-    bool ok = loadMnistNormRowByIndex(
-        path+"mnist_train.csv",
-        targetRow,
-        targetValue,
-        vals
-    );
-
-    if(!ok){
-        cerr << "Error loading MNIST image\n";
-        return 1;
+    vector<vector<double>> images(batch);
+    vector<size_t> labels(batch);
+
+    for(size_t b = 0; b < batch; ++b){
+        bool ok = cache
+            ? cache->row(targetRow + b, labels[b], images[b])
+            : loadMnistNormRowByIndex(
+                path+"mnist_train.csv",
+                targetRow + b,
+                labels[b],
+                images[b]
+            );
+
+        if(!ok){
+            cerr << "Error loading MNIST image\n";
+            return 1;
+        }
     }
+    size_t targetValue = labels[0];
 
 
     if(verbose)
         std::cout << "Encrypting input..." << std::endl;
     uint32_t hidden_layer    = 0;
     uint32_t reduceSum_layer = 0;
-    IterationResult res = run_iteration_NN(he, encoded, vals, args, targetValue, hidden_layer, reduceSum_layer);
+    // Single-neuron and decrypt/decode stages start from the clean run; when
+    // it is cached, the clean predictions come from its logits
+    NNCleanCache clean;
+    if (cleanCacheApplies(args))
+        buildCleanCache(he, encoded, images, args, clean);
+
+    // Faulty predictions are compared against these, image by image
+    vector<size_t> cleanPreds;
+    IterationResult res = run_iteration_NN_batch(he, encoded, images, args, targetValue,
+                                                 cleanPreds, hidden_layer, reduceSum_layer,
+                                                 std::nullopt, &clean);
+    if(batch > 1){
+        size_t correct = 0;
+        for(size_t b = 0; b < batch; ++b)
+            correct += (cleanPreds[b] == labels[b]);
+        std::cout << "Clean accuracy: " << correct << "/" << batch << std::endl;
+    }
     if(res.detected)
     {
         try{
@@ -99,7 +78,7 @@ int main(int argc, char* argv[]) {
 
             std::cout << "\n=== Starting Campaign " << campaign_id << " ===" << std::endl;
 
-            CampaignLogger logger(campaign_id, args.results_dir + "/data", 10000);
+            CampaignLogger logger(campaign_id, args.results_dir + "/data", 10000, RecordOptions::from(args));
 
             std::cout << "Campaign " << campaign_id << " registered" << std::endl;
 
@@ -119,6 +98,14 @@ int main(int argc, char* argv[]) {
 
             std::mt19937 rng(args.seed);
 
+            // --profile: one JSON line per iteration, then the campaign aggregate
+            std::unique_ptr<NNProfiler> profiler;
+            std::string profileBase = args.results_dir + "/data/profile_" + std::to_string(campaign_id);
+            if (args.profile) {
+                profiler = std::make_unique<NNProfiler>(profileBase + ".jsonl");
+                he.profiler = profiler.get();
+            }
+
            // std::vector<uint32_t> bits_to_flip = extraBitsBetweenDeltaAndQ(args); // 10 values
             std::vector<uint32_t> bits_to_flip = bitsToFlipGenerator(args); // 14 values
             for (size_t bitIndex = 0; bitIndex < 2 ; bitIndex++) {
@@ -138,15 +125,22 @@ int main(int argc, char* argv[]) {
                         }
                     }
                     else{
-                        IterationResult res = run_iteration_NN(he, encoded, vals,
-                                args, targetValue, hidden_layer,
-                                reduceSum_layer, iterArgs);
+                        vector<size_t> preds;
+                        run_iteration_NN_batch(he, encoded, images,
+                                args, targetValue, preds, hidden_layer,
+                                reduceSum_layer, iterArgs, &clean);
+                        if (profiler) profiler->endRun();
+                        // correct/failed count images whose prediction kept/changed
                         SlotErrorStats  stats;
+                        for(size_t b = 0; b < batch; ++b){
+                            if(preds[b] == cleanPreds[b]) stats.correct++;
+                            else                          stats.failed++;
+                        }
                         logger.log(iterArgs.limb,
                                 iterArgs.coeff,
                                 iterArgs.bit,
                                 0.0, 0.0,
-                                !res.detected,     // is_sdc: predict correct or not, we need to negate. 1 will be sdc, bad. 0 will be mask, good.
+                                stats.failed > 0,     // is_sdc: some image changed its prediction. 1 will be sdc, bad. 0 will be mask, good.
                                 stats,
                                 hidden_layer,
                                 reduceSum_layer
@@ -155,6 +149,10 @@ int main(int argc, char* argv[]) {
                 }
 
             }
+            if (profiler) {
+                profiler->writeAggregate(profileBase + ".json");
+                he.profiler = nullptr;
+            }
             auto end_time = std::chrono::high_resolution_clock::now();
             std::chrono::seconds duration = std::chrono::duration_cast<std::chrono::seconds>(end_time - start_time);
             auto minutes = std::chrono::duration_cast<std::chrono::minutes>(duration);
@@ -163,6 +161,7 @@ int main(int argc, char* argv[]) {
             registry.register_end({campaign_id, logger.total(), logger.sdc(), mins, 0.0, 0.0, timestamp_now()});
         }
         catch (const std::runtime_error& e) {
+            he.profiler = nullptr;
             std::cerr << e.what() << '\n';
             return 0;
         }
@@ -173,3 +172,97 @@ int main(int argc, char* argv[]) {
 
     return 0;
 }
+
+int main(int argc, char* argv[]) {
+
+    std::cout << "\n=== Starting Campaign "<< std::endl;
+    CampaignArgs args = parse_arguments(argc, argv);
+    args.library = "heaanNN";
+    args.isExhaustive= false;
+    args.mult_depth = 0;
+    args.existing_policy = existing_policy;
+
+    if (args.verbose) {
+        args.print();
+    }
+
+
+    long logQ = args.logQ;
+    long logP = args.logDelta;
+    long logN = args.logN;
+    long logSlots = args.logSlots;
+    long slots = 1 << logSlots;
+    long h = 64;
+
+    size_t verbose =  args.verbose;
+
+    assert(INPUT_DIM <= slots);
+    if(verbose)
+        std::cout << "Initializing HE..." << std::endl;
+
+    HEEnv he(logN, logQ, h, logSlots);
+    // The packed forward also needs its baby/giant/stride rotations
+    if(args.nnPacked)
+        he.addRotKeys(packedRotations(packedLayout(slots, HIDDEN_DIM, OUTPUT_DIM)));
+
+    // Binary cache written by nnCacheConvert, the CSVs otherwise
+    auto cache = NNCache::openIfExists(path + NN_CACHE_FILE);
+    if(cache && (cache->input() != INPUT_DIM || cache->hidden() != HIDDEN_DIM ||
+                 cache->output() != OUTPUT_DIM)){
+        cerr << "NN cache " << cache->path() << " does not match the network dimensions\n";
+        return 1;
+    }
+
+    if(verbose)
+        std::cout << "Loading weights" << (cache ? " from cache" : "") << "..." << std::endl;
+
+    auto W1  = cache ? cache->W1() : loadCSVMatrix(path+"weights/W1.csv", HIDDEN_DIM, INPUT_DIM);
+    auto b1  = cache ? cache->b1() : loadCSVVector(path+"weights/b1.csv", HIDDEN_DIM);
+
+    auto W2  = cache ? cache->W2() : loadCSVMatrix(path+"weights/W2.csv", OUTPUT_DIM, HIDDEN_DIM);
+    auto b2  = cache ? cache->b2() : loadCSVVector(path+"weights/b2.csv", OUTPUT_DIM);
+    assert(W1[0].size() == INPUT_DIM);
+    assert(W2[0].size() == HIDDEN_DIM);
+
+
+
+    if(verbose)
+        std::cout << "Encoding weights..." << std::endl;
+
+    // Images row .. row+batch-1 of every swept row, one per block of `slots` slots
+    size_t batch = args.nnBatch;
+    if(batch == 0 || (batch & (batch-1)) != 0 || slots*batch > (1L << (logN-1))){
+        cerr << "nnBatch must be a power of 2 with nnBatch * 2^logSlots <= 2^(logN-1)\n";
+        return 1;
+    }
+    if(args.nnPacked && batch != 1){
+        cerr << "nnPacked uses the whole block for one image, nnBatch must be 1\n";
+        return 1;
+    }
+
+    EncodedWeights encoded = args.nnPacked
+        ? encodeWeightsPacked(he, W1, b1, W2, b2, slots, logP, cache.get())
+        : encodeWeights(he, W1, b1, W2, b2, slots*batch, logP, slots, cache.get());
+
+    if(verbose)
+        std::cout << "Ready for inference.\n" << std::endl;
+
+    // One campaign per row; HEEnv and the encoded weights are shared
+    vector<uint32_t> rows = args.rows.empty()
+        ? vector<uint32_t>{args.seed}
+        : parse_row_list(args.rows);
+    if(rows.size() == 1){
+        args.seed = rows[0];
+        return runImageCampaign(he, encoded, cache.get(), args, batch);
+    }
+
+    size_t skipped = 0;
+    for(uint32_t row : rows){
+        std::cout << "\n=== Image row " << row << " ===" << std::endl;
+        args.seed = row;
+        if(runImageCampaign(he, encoded, cache.get(), args, batch) != 0)
+            skipped++;
+    }
+    std::cout << "Swept " << rows.size() << " rows, " << skipped << " skipped" << std::endl;
+    return 0;
+}
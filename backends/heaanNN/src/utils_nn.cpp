@@ -1,5 +1,82 @@
 #include "utils_nn.h"
 #include "backend_interface.h"
+#include <cstring>
+
+// Pre-encoded weights live in the NN cache as blobs tagged with the
+// encoding parameters. Per polynomial: uint64 length, uint32 byte width,
+// one sign byte per coefficient, then the magnitudes little endian.
+static void appendPoly(std::vector<uint8_t>& out, const ZZX& poly)
+{
+    const uint64_t len = poly.rep.length();
+    uint32_t width = 0;
+    for (long i = 0; i < poly.rep.length(); ++i)
+        width = std::max<uint32_t>(width, NumBytes(poly.rep[i]));
+
+    size_t at = out.size();
+    out.resize(at + sizeof(len) + sizeof(width) + len * (1 + width));
+    uint8_t* p = out.data() + at;
+    std::memcpy(p, &len, sizeof(len));      p += sizeof(len);
+    std::memcpy(p, &width, sizeof(width));  p += sizeof(width);
+    for (long i = 0; i < poly.rep.length(); ++i)
+        *p++ = sign(poly.rep[i]) < 0;
+    ZZ mag;
+    for (long i = 0; i < poly.rep.length(); ++i, p += width) {
+        abs(mag, poly.rep[i]);
+        BytesFromZZ(p, mag, width);
+    }
+}
+
+static const uint8_t* readPoly(const uint8_t* p, const uint8_t* end, ZZX& poly)
+{
+    uint64_t len;
+    uint32_t width;
+    if (p + sizeof(len) + sizeof(width) > end)
+        return nullptr;
+    std::memcpy(&len, p, sizeof(len));      p += sizeof(len);
+    std::memcpy(&width, p, sizeof(width));  p += sizeof(width);
+    if (static_cast<uint64_t>(end - p) < len * (1 + width))
+        return nullptr;
+
+    const uint8_t* signs = p;
+    p += len;
+    poly.rep.SetLength(len);
+    for (uint64_t i = 0; i < len; ++i, p += width) {
+        ZZFromBytes(poly.rep[i], p, width);
+        if (signs[i]) NTL::negate(poly.rep[i], poly.rep[i]);
+    }
+    poly.normalize();
+    return p;
+}
+
+static std::string encodedTag(const char* kind, HEEnv& he, long slots, long logP, long block)
+{
+    return std::string("heaan/") + kind + "/logN=" + std::to_string(he.context.logN) +
+           "/slots=" + std::to_string(slots) + "/logP=" + std::to_string(logP) +
+           "/block=" + std::to_string(block);
+}
+
+static bool loadEncoded(const NNCache* cache, const std::string& tag, const vector<ZZX*>& polys)
+{
+    const uint8_t* data;
+    size_t size;
+    if (!cache || !cache->findBlob(tag, data, size))
+        return false;
+    const uint8_t* end = data + size;
+    for (ZZX* poly : polys)
+        if (!(data = readPoly(data, end, *poly)))
+            throw std::runtime_error("encodeWeights: blob " + tag + " truncado en " + cache->path());
+    return true;
+}
+
+static void storeEncoded(const NNCache* cache, const std::string& tag, const vector<ZZX*>& polys)
+{
+    if (!cache)
+        return;
+    std::vector<uint8_t> blob;
+    for (ZZX* poly : polys)
+        appendPoly(blob, *poly);
+    NNCache::appendBlob(cache->path(), tag, blob);
+}
 
 EncodedWeights encodeWeights(
     HEEnv& he,
@@ -8,44 +85,90 @@ EncodedWeights encodeWeights(
     const vector<vector<double>>& W2,
     const vector<double>& b2,
     long slots,
-    long logP
+    long logP,
+    long blockSize,
+    const NNCache* cache
 ){
     EncodedWeights ew;
 
     size_t HIDDEN = W1.size();
     size_t INPUT  = W1[0].size();
-    size_t OUTPUT = W2.size();
+    size_t block  = blockSize > 0 ? blockSize : slots;
 
     ew.W1.resize(HIDDEN);
+    // Layer 2 and the biases are slot-constant: kept as scalars for
+    // multByConst/addConst instead of OUTPUT*HIDDEN encoded polynomials
+    ew.W2 = W2;
+    ew.b1 = b1;
+    ew.b2 = b2;
+
+    vector<ZZX*> polys;
+    for (auto& p : ew.W1) polys.push_back(&p);
+
+    const std::string tag = encodedTag("W1", he, slots, logP, block);
+    if (loadEncoded(cache, tag, polys))
+        return ew;
 
     vector<double> buffer(slots, 0.0);
 
     for(size_t j=0;j<HIDDEN;++j){
         fill(buffer.begin(), buffer.end(), 0.0);
 
-        for(size_t i=0;i<INPUT;++i)
-            buffer[i] = W1[j][i];
+        // One copy of the row per image block
+        for(size_t b=0;b<(size_t)slots;b+=block)
+            for(size_t i=0;i<INPUT;++i)
+                buffer[b+i] = W1[j][i];
 
         ew.W1[j] = he.context.encode(buffer.data(), slots, logP);
     }
 
+    storeEncoded(cache, tag, polys);
+    return ew;
+}
+
+EncodedWeights encodeWeightsPacked(
+    HEEnv& he,
+    const vector<vector<double>>& W1,
+    const vector<double>& b1,
+    const vector<vector<double>>& W2,
+    const vector<double>& b2,
+    long slots,
+    long logP,
+    const NNCache* cache
+){
+    EncodedWeights ew;
+    ew.layout = packedLayout(slots, W1.size(), W2.size());
     ew.b1 = b1;
+    ew.b2 = b2;
+    ew.W1diag.resize(ew.layout.m);
 
-    ew.W2.resize(OUTPUT, vector<ZZX>(HIDDEN));
+    vector<ZZX*> polys;
+    for (auto& p : ew.W1diag) polys.push_back(&p);
+    polys.push_back(&ew.b1Packed);
+    polys.push_back(&ew.W2Packed);
+    polys.push_back(&ew.b2Packed);
 
-    for(size_t o=0;o<OUTPUT;++o){
-        for(size_t h=0;h<HIDDEN;++h){
+    const std::string tag = encodedTag("packed", he, slots, logP, slots);
+    if (loadEncoded(cache, tag, polys))
+        return ew;
 
-            fill(buffer.begin(), buffer.end(), W2[o][h]);
+    auto diags = packedDiagonals(ew.layout, W1);
+    for (size_t k = 0; k < diags.size(); ++k)
+        ew.W1diag[k] = he.context.encode(diags[k].data(), slots, logP);
 
-            ew.W2[o][h] = he.context.encode(buffer.data(), slots, logP);
-        }
-    }
+    auto b1p = packedRepeat(ew.layout, b1);
+    ew.b1Packed = he.context.encode(b1p.data(), slots, logP);
 
-    ew.b2 = b2;
+    auto w2p = packedLayer2(ew.layout, W2);
+    ew.W2Packed = he.context.encode(w2p.data(), slots, logP);
+
+    auto b2p = packedBias2(ew.layout, b2);
+    ew.b2Packed = he.context.encode(b2p.data(), slots, logP);
 
+    storeEncoded(cache, tag, polys);
     return ew;
 }
+
 Ciphertext encryptInput(
     HEEnv& he,
     const vector<double>& vals,
@@ -72,6 +195,12 @@ Ciphertext chebyTanh3(
     bool doBitFlip,
     CampaignArgs& args, std::optional<IterationArgs> iterArgs
 ){
+    ProfileScope scope(he.profiler, "layer1.chebyTanh3");
+    // 2 ciphertext products (relinearized), 2 constant products, 4 rescales
+    profileCount(he.profiler, "mult_ct", 2);
+    profileCount(he.profiler, "key_switch", 2);
+    profileCount(he.profiler, "mult_const", 2);
+    profileCount(he.profiler, "rescale", 4);
     // x^2
 
     if (doBitFlip && iterArgs && args.stage == "cheby_tanh3") {
@@ -126,28 +255,32 @@ Ciphertext chebyTanh3(
     return c3;
 }
 
-void reduceSum(
+// ct += rot(ct, stride << i) for i < levels. The hidden_layer hooks
+// (op_step 4-11) hit level hookLevel; hookLevel >= levels disables them.
+static void rotateSum(
     HEEnv& he,
     Ciphertext& ct,
-    long logSlots,
-    CampaignArgs& args,
-    uint32_t &reduceSum_layer, std::optional<IterationArgs> iterArgs
+    long stride,
+    long levels,
+    long hookLevel,
+    CampaignArgs& args, std::optional<IterationArgs> iterArgs
 ){
-    reduceSum_layer = random_int(0, logSlots-1);
-
-    for(int i=0;i<logSlots;i++){
+    profileCount(he.profiler, "rotation", levels);
+    profileCount(he.profiler, "key_switch", levels);
+    for(int i=0;i<levels;i++){
+        long r = stride << i;
         Ciphertext rot;
-        if (i==reduceSum_layer && iterArgs && args.stage == "hidden_layer") {
+        if (i==hookLevel && iterArgs && args.stage == "hidden_layer") {
             Ciphertext c_copy = ct;
             if (args.op_step == 4) {
                 SwitchBit(c_copy.bx[iterArgs->coeff], iterArgs->bit);
             } else if (args.op_step == 5) {
                 SwitchBit(c_copy.ax[iterArgs->coeff], iterArgs->bit);
             }
-            rot = he.scheme.leftRotateFast(c_copy, 1<<i);
+            rot = he.scheme.leftRotateFast(c_copy, r);
         } else
-            rot = he.scheme.leftRotateFast(ct, 1<<i);
-        if (i==reduceSum_layer && iterArgs && args.stage == "hidden_layer") {
+            rot = he.scheme.leftRotateFast(ct, r);
+        if (i==hookLevel && iterArgs && args.stage == "hidden_layer") {
             if (args.op_step == 6) {
                 SwitchBit(rot.bx[iterArgs->coeff], iterArgs->bit);
             } else if (args.op_step == 7) {
@@ -159,7 +292,7 @@ void reduceSum(
             }
         }
         he.scheme.addAndEqual(ct, rot);
-        if (i==reduceSum_layer && iterArgs && args.stage == "hidden_layer") {
+        if (i==hookLevel && iterArgs && args.stage == "hidden_layer") {
             if (args.op_step == 10) {
                 SwitchBit(ct.bx[iterArgs->coeff], iterArgs->bit);
             }else if (args.op_step == 11) {
@@ -169,6 +302,94 @@ void reduceSum(
     }
 }
 
+void reduceSum(
+    HEEnv& he,
+    Ciphertext& ct,
+    long logSlots,
+    CampaignArgs& args,
+    uint32_t reduceSum_layer, std::optional<IterationArgs> iterArgs
+){
+    rotateSum(he, ct, 1, logSlots, reduceSum_layer, args, iterArgs);
+}
+
+// bx += poly mod q: plaintext addition, poly encoded at ct.logp
+static void addPlainAndEqual(HEEnv& he, Ciphertext& ct, ZZX& poly)
+{
+    ZZ& q = he.context.qpowvec[ct.logq];
+    Ring2Utils::addAndEqual(ct.bx, poly, q, he.context.N);
+}
+
+// Chain of neuron j: multByPoly, rescale, reduceSum, bias, activation.
+// With target set it carries the hidden_layer/cheby_tanh3 hooks, the
+// reduceSum ones at level reduceSum_layer.
+static Ciphertext hiddenNeuron(
+    HEEnv& he,
+    Ciphertext& c,
+    EncodedWeights& ew,
+    size_t j,
+    long logSlots,
+    long logP,
+    bool target,
+    uint32_t reduceSum_layer,
+    CampaignArgs& args, std::optional<IterationArgs> iterArgs
+){
+    ProfileScope neuronScope(he.profiler, "layer1.neuron", j);
+    Ciphertext s;
+    {
+    ProfileScope scope(he.profiler, "layer1.multByPoly");
+    profileCount(he.profiler, "mult_plain");
+    if (target && iterArgs && args.stage == "hidden_layer") {
+        Ciphertext c_copy = c;
+        if (args.op_step == 0) {
+            SwitchBit(c_copy.bx[iterArgs->coeff], iterArgs->bit);
+        } else if (args.op_step == 1) {
+            SwitchBit(c_copy.ax[iterArgs->coeff], iterArgs->bit);
+        }
+        s = he.scheme.multByPoly(c_copy, ew.W1[j], logP);
+    } else
+        s = he.scheme.multByPoly(c, ew.W1[j], logP);
+
+    if (target && iterArgs && args.stage == "hidden_layer") {
+        if (args.op_step == 2) {
+            SwitchBit(s.bx[iterArgs->coeff], iterArgs->bit);
+        }else if (args.op_step == 3) {
+            SwitchBit(s.ax[iterArgs->coeff], iterArgs->bit);
+        }
+    }
+
+    he.scheme.reScaleByAndEqual(s, logP);
+    profileCount(he.profiler, "rescale");
+    }
+
+    {
+    ProfileScope scope(he.profiler, "layer1.reduceSum");
+    reduceSum(he, s, logSlots, args,
+              target ? reduceSum_layer : logSlots, iterArgs);
+    }
+
+    he.scheme.addConstAndEqual(s, ew.b1[j]);
+    if (target && iterArgs && args.stage == "hidden_layer") {
+        if (args.op_step == 12) {
+            SwitchBit(s.bx[iterArgs->coeff], iterArgs->bit);
+        }else if (args.op_step == 13) {
+            SwitchBit(s.ax[iterArgs->coeff], iterArgs->bit);
+        }
+    }
+    return chebyTanh3(he, std::move(s), logP, target, args, iterArgs);
+}
+
+// Contribution of neuron j to output o (before the b2 bias)
+static Ciphertext layer2Term(HEEnv& he, Ciphertext& a, EncodedWeights& ew,
+                             size_t o, size_t j, long logP)
+{
+    ProfileScope scope(he.profiler, "layer2.multByConst");
+    Ciphertext term = he.scheme.multByConst(a, ew.W2[o][j], logP);
+    he.scheme.reScaleByAndEqual(term, logP);
+    profileCount(he.profiler, "mult_const");
+    profileCount(he.profiler, "rescale");
+    return term;
+}
+
 vector<Ciphertext> forward(
     HEEnv& he,
     Ciphertext& c,
@@ -177,70 +398,190 @@ vector<Ciphertext> forward(
     long logP,
     uint32_t &hidden_layer,
     uint32_t &reduceSum_layer,
-    CampaignArgs& args, std::optional<IterationArgs> iterArgs
+    CampaignArgs& args, std::optional<IterationArgs> iterArgs,
+    vector<Ciphertext>* layer1Out
 )
 {
+    ProfileScope forwardScope(he.profiler, "forward");
     size_t HIDDEN = ew.W1.size();
     size_t OUTPUT = ew.W2.size();
+    size_t threads = std::max<uint32_t>(args.threads, 1);
 
-    vector<Ciphertext> layer1;
-    layer1.reserve(HIDDEN);
-
+    // Both targets are drawn here, not in the workers: random_int is
+    // thread_local, and only neuron hidden_layer gets the reduceSum hooks.
     hidden_layer = random_int(0, HIDDEN-1);
-    for(size_t j=0;j<HIDDEN;++j){
-        Ciphertext s;
-        if (j==hidden_layer && iterArgs && args.stage == "hidden_layer") {
-            Ciphertext c_copy = c;
-            if (args.op_step == 0) {
-                SwitchBit(c_copy.bx[iterArgs->coeff], iterArgs->bit);
-            } else if (args.op_step == 1) {
-                SwitchBit(c_copy.ax[iterArgs->coeff], iterArgs->bit);
-            }
-            s = he.scheme.multByPoly(c_copy, ew.W1[j], logP);
-        } else
-            s = he.scheme.multByPoly(c, ew.W1[j], logP);
+    reduceSum_layer = random_int(0, logSlots-1);
 
-        if (j==hidden_layer && iterArgs && args.stage == "hidden_layer") {
-            if (args.op_step == 2) {
-                SwitchBit(s.bx[iterArgs->coeff], iterArgs->bit);
-            }else if (args.op_step == 3) {
-                SwitchBit(s.ax[iterArgs->coeff], iterArgs->bit);
-            }
+    vector<Ciphertext> layer1(HIDDEN);
+
+    parallel_for(HIDDEN, threads, [&](size_t j, size_t) {
+        layer1[j] = hiddenNeuron(he, c, ew, j, logSlots, logP,
+                                 j==hidden_layer, reduceSum_layer, args, iterArgs);
+    });
+
+    // Layer 2, one output at a time (keeps HIDDEN terms alive, not
+    // OUTPUT*HIDDEN): products in parallel, then a fixed pairwise tree so
+    // the logits do not depend on the thread count.
+    vector<Ciphertext> out;
+    out.reserve(OUTPUT);
+    vector<vector<Ciphertext>> terms(1, vector<Ciphertext>(HIDDEN));
+    for(size_t o=0;o<OUTPUT;++o){
+        parallel_for(HIDDEN, threads, [&](size_t h, size_t) {
+            terms[0][h] = layer2Term(he, layer1[h], ew, o, h, logP);
+        });
+        {
+        ProfileScope scope(he.profiler, "layer2.accumulate");
+        parallel_tree_reduce(terms, threads, [&](Ciphertext& a, Ciphertext& b) {
+            he.scheme.addAndEqual(a, b);
+        });
         }
 
-        he.scheme.reScaleByAndEqual(s, logP);
+        Ciphertext acc = std::move(terms[0][0]);
+        he.scheme.addConstAndEqual(acc, ew.b2[o]);
+        out.push_back(std::move(acc));
+    }
+
+    if (layer1Out)
+        *layer1Out = std::move(layer1);
+    return out;
+}
+
+// Only neuron hidden_layer differs from the clean run, and additions are
+// exact mod q, so out[o] = clean[o] - term_clean + term_faulty gives the
+// same ciphertexts as the full forward.
+static vector<Ciphertext> forwardOneNeuron(
+    HEEnv& he,
+    const NNCleanCache& clean,
+    EncodedWeights& ew,
+    long logSlots,
+    long logP,
+    uint32_t &hidden_layer,
+    uint32_t &reduceSum_layer,
+    CampaignArgs& args, std::optional<IterationArgs> iterArgs
+)
+{
+    ProfileScope forwardScope(he.profiler, "forward.oneNeuron");
+    size_t HIDDEN = ew.W1.size();
+    size_t OUTPUT = ew.W2.size();
+    size_t threads = std::max<uint32_t>(args.threads, 1);
 
-        reduceSum(he, s, logSlots, args, reduceSum_layer, iterArgs);
+    // Same draws, in the same order, as forward
+    hidden_layer = random_int(0, HIDDEN-1);
+    reduceSum_layer = random_int(0, logSlots-1);
+    const size_t j = hidden_layer;
+
+    Ciphertext input = clean.input;
+    Ciphertext faulty = hiddenNeuron(he, input, ew, j, logSlots, logP,
+                                     true, reduceSum_layer, args, iterArgs);
+    Ciphertext cleanAct = clean.layer1[j];
+
+    vector<Ciphertext> out = clean.outputs;
+    parallel_for(OUTPUT, threads, [&](size_t o, size_t) {
+        Ciphertext termClean = layer2Term(he, cleanAct, ew, o, j, logP);
+        Ciphertext termFaulty = layer2Term(he, faulty, ew, o, j, logP);
+        he.scheme.subAndEqual(out[o], termClean);
+        he.scheme.addAndEqual(out[o], termFaulty);
+    });
+    return out;
+}
 
-        he.scheme.addConstAndEqual(s, ew.b1[j]);
-        if (j==hidden_layer && iterArgs && args.stage == "hidden_layer") {
-            if (args.op_step == 12) {
-                SwitchBit(s.bx[iterArgs->coeff], iterArgs->bit);
-            }else if (args.op_step == 13) {
-                SwitchBit(s.ax[iterArgs->coeff], iterArgs->bit);
+vector<Ciphertext> forwardPacked(
+    HEEnv& he,
+    Ciphertext& c,
+    EncodedWeights& ew,
+    long logP,
+    uint32_t &hidden_layer,
+    uint32_t &reduceSum_layer,
+    CampaignArgs& args, std::optional<IterationArgs> iterArgs
+)
+{
+    ProfileScope forwardScope(he.profiler, "forward");
+    const PackedMLPLayout& L = ew.layout;
+    const bool hook = iterArgs && args.stage == "hidden_layer";
+
+    std::optional<ProfileScope> layer1Scope;
+    layer1Scope.emplace(he.profiler, "packed.layer1");
+    profileCount(he.profiler, "mult_plain", L.n1*L.n2);
+    profileCount(he.profiler, "rotation", (L.n1-1) + (L.n2-1));
+    profileCount(he.profiler, "key_switch", (L.n1-1) + (L.n2-1));
+    profileCount(he.profiler, "rescale");
+
+    // Baby steps, shared by every giant step
+    vector<Ciphertext> babies;
+    babies.reserve(L.n1);
+    babies.push_back(c);
+    for(size_t b=1;b<L.n1;++b)
+        babies.push_back(he.scheme.leftRotateFast(c, b));
+
+    hidden_layer = random_int(0, L.m-1);
+    reduceSum_layer = random_int(0, L.strideLevels-1);
+
+    Ciphertext z;
+    for(size_t g=0;g<L.n2;++g){
+        Ciphertext inner;
+        for(size_t b=0;b<L.n1;++b){
+            size_t k = g*L.n1 + b;
+            Ciphertext s;
+            if (k==hidden_layer && hook && args.op_step <= 1) {
+                Ciphertext c_copy = babies[b];
+                if (args.op_step == 0) {
+                    SwitchBit(c_copy.bx[iterArgs->coeff], iterArgs->bit);
+                } else {
+                    SwitchBit(c_copy.ax[iterArgs->coeff], iterArgs->bit);
+                }
+                s = he.scheme.multByPoly(c_copy, ew.W1diag[k], logP);
+            } else
+                s = he.scheme.multByPoly(babies[b], ew.W1diag[k], logP);
+
+            if (k==hidden_layer && hook) {
+                if (args.op_step == 2) {
+                    SwitchBit(s.bx[iterArgs->coeff], iterArgs->bit);
+                }else if (args.op_step == 3) {
+                    SwitchBit(s.ax[iterArgs->coeff], iterArgs->bit);
+                }
             }
+
+            if (b == 0) inner = std::move(s);
+            else        he.scheme.addAndEqual(inner, s);
+        }
+        if (g == 0) {
+            z = std::move(inner);
+        } else {
+            Ciphertext rot = he.scheme.leftRotateFast(inner, g*L.n1);
+            he.scheme.addAndEqual(z, rot);
         }
-        s = chebyTanh3(he, std::move(s), logP, hidden_layer==j, args, iterArgs);
-        layer1.push_back(std::move(s));
     }
+    he.scheme.reScaleByAndEqual(z, logP);
+    layer1Scope.reset();
 
-    vector<Ciphertext> out;
-    out.reserve(OUTPUT);
-    for(size_t o=0;o<OUTPUT;++o){
-
-        Ciphertext acc = he.scheme.multByPoly(layer1[0], ew.W2[o][0], logP);
-        he.scheme.reScaleByAndEqual(acc, logP);
+    // Fold the n/m partial sums: every slot i ends up with h[i mod m]
+    {
+    ProfileScope scope(he.profiler, "packed.strideSum");
+    rotateSum(he, z, L.m, L.strideLevels, reduceSum_layer, args, iterArgs);
+    }
 
-        for(size_t h=1;h<HIDDEN;++h){
-            Ciphertext term = he.scheme.multByPoly(layer1[h], ew.W2[o][h], logP);
-            he.scheme.reScaleByAndEqual(term, logP);
-            he.scheme.addAndEqual(acc, term);
+    addPlainAndEqual(he, z, ew.b1Packed);
+    if (hook) {
+        if (args.op_step == 12) {
+            SwitchBit(z.bx[iterArgs->coeff], iterArgs->bit);
+        }else if (args.op_step == 13) {
+            SwitchBit(z.ax[iterArgs->coeff], iterArgs->bit);
         }
-
-        he.scheme.addConstAndEqual(acc, ew.b2[o]);
-        out.push_back(std::move(acc));
     }
 
+    Ciphertext a = chebyTanh3(he, std::move(z), logP, true, args, iterArgs);
+
+    // Layer 2: W2[o][j]*a[j] at slot o*m+j, then sum each block of m
+    ProfileScope layer2Scope(he.profiler, "packed.layer2");
+    profileCount(he.profiler, "mult_plain");
+    profileCount(he.profiler, "rescale");
+    Ciphertext acc = he.scheme.multByPoly(a, ew.W2Packed, logP);
+    he.scheme.reScaleByAndEqual(acc, logP);
+    rotateSum(he, acc, 1, L.logM, L.logM, args, iterArgs);
+    addPlainAndEqual(he, acc, ew.b2Packed);
+
+    vector<Ciphertext> out;
+    out.push_back(std::move(acc));
     return out;
 }
 
@@ -248,6 +589,7 @@ vector<Plaintext> decryptLogits(
     HEEnv& he,
     vector<Ciphertext>& outs
 ){
+    ProfileScope scope(he.profiler, "client.decrypt");
     vector<Plaintext> res;
     res.reserve(outs.size());
     for (auto& ct : outs) {
@@ -266,13 +608,54 @@ vector<double> decodeLogits(
     vector<double> res;
     res.reserve(pts.size());
 
+    // Only slot 0 holds the logit, so skip the full fft
+    static const std::vector<size_t> logitSlot = {0};
+    std::complex<double> logit;
 
     for (auto& pt : pts) {
-        std::unique_ptr<std::complex<double>[]> tmp(
-            he.scheme.decode(pt)
-        );
+        decodeSlots(he.context, pt, logitSlot, &logit);
+        res.push_back(logit.real());
+    }
+    return res;
+}
+
+vector<double> decodeLogitsPacked(
+    HEEnv& he,
+    Plaintext& pt,
+    size_t stride,
+    size_t outputs
+){
+    std::vector<size_t> logitSlots(outputs);
+    for (size_t o = 0; o < outputs; ++o)
+        logitSlots[o] = o * stride;
+    std::vector<std::complex<double>> logit(outputs);
+
+    decodeSlots(he.context, pt, logitSlots, logit.data());
+
+    vector<double> res(outputs);
+    for (size_t o = 0; o < outputs; ++o)
+        res[o] = logit[o].real();
+    return res;
+}
 
-        res.push_back(tmp[0].real());
+vector<vector<double>> decodeLogitsBatch(
+    HEEnv& he,
+    vector<Plaintext>& pts,
+    size_t blockSize,
+    size_t batch
+){
+    vector<vector<double>> res(batch, vector<double>(pts.size()));
+
+    // Image b's logit sits at slot b*blockSize of every output
+    std::vector<size_t> logitSlots(batch);
+    for (size_t b = 0; b < batch; ++b)
+        logitSlots[b] = b * blockSize;
+    std::vector<std::complex<double>> logit(batch);
+
+    for (size_t o = 0; o < pts.size(); ++o) {
+        decodeSlots(he.context, pts[o], logitSlots, logit.data());
+        for (size_t b = 0; b < batch; ++b)
+            res[b][o] = logit[b].real();
     }
     return res;
 }
@@ -397,24 +780,23 @@ std::vector<double> loadCSVVector(const std::string& path, size_t size) {
 }
 
 
-IterationResult run_iteration_NN(HEEnv& he, EncodedWeights& encoded,
-        const vector<double>& vals, CampaignArgs& args, size_t targetValue,
-        uint32_t &hidden_layer,  uint32_t &reduceSum_layer,
-        std::optional<IterationArgs> iterArgs ){
-
-    size_t logSlots = args.logSlots;
-    size_t slots = 1 << logSlots;
-    size_t logP = args.logDelta;
-    size_t logQ = args.logQ;
-    size_t verbose = args.verbose;
-
+// images[b] in slot block b, encoded and encrypted with args.seed; the
+// encode/encrypt_c0/encrypt_c1 faults are applied here
+static Ciphertext encryptImages(HEEnv& he, const vector<vector<double>>& images,
+        CampaignArgs& args, std::optional<IterationArgs> iterArgs)
+{
+    ProfileScope scope(he.profiler, "client.encrypt");
+    size_t blockSize = 1 << args.logSlots;
+    size_t batch = images.size();
+    size_t slots = blockSize * batch;
 
     vector<complex<double>> arr(slots, {0,0});
 
-    for(size_t i=0;i<vals.size();++i)
-        arr[i] = {vals[i],0};
+    for(size_t b=0;b<batch;++b)
+        for(size_t i=0;i<images[b].size();++i)
+            arr[b*blockSize+i] = {images[b][i],0};
 
-    Plaintext plain = he.scheme.encode(arr.data(), slots, logP, logQ);
+    Plaintext plain = he.scheme.encode(arr.data(), slots, args.logDelta, args.logQ);
 
     if (iterArgs && args.stage == "encode") {
         SwitchBit(plain.mx[iterArgs->coeff], iterArgs->bit);
@@ -428,10 +810,159 @@ IterationResult run_iteration_NN(HEEnv& he, EncodedWeights& encoded,
             SwitchBit(c.ax[iterArgs->coeff], iterArgs->bit);
         }
     }
+    return c;
+}
+
+// Logits of every image, from decrypted outputs
+static vector<vector<double>> decodeAll(HEEnv& he, EncodedWeights& encoded,
+        vector<Plaintext>& pts, CampaignArgs& args, size_t batch)
+{
+    ProfileScope scope(he.profiler, "client.decode");
+    return args.nnPacked
+        ? vector<vector<double>>{decodeLogitsPacked(he, pts[0], encoded.layout.m, encoded.layout.out)}
+        : decodeLogitsBatch(he, pts, 1 << args.logSlots, batch);
+}
+
+static bool isOneNeuronStage(const CampaignArgs& args)
+{
+    return !args.nnPacked &&
+        (args.stage == "hidden_layer" || args.stage == "cheby_tanh3");
+}
+
+static bool isLateStage(const CampaignArgs& args)
+{
+    return args.stage == "decrypt_c0" || args.stage == "decrypt_c1" ||
+           args.stage == "decode";
+}
+
+bool cleanCacheApplies(const CampaignArgs& args)
+{
+    return isOneNeuronStage(args) || isLateStage(args);
+}
+
+void buildCleanCache(HEEnv& he, EncodedWeights& encoded,
+        const vector<vector<double>>& images, CampaignArgs& args,
+        NNCleanCache& clean)
+{
+    clean.input = encryptImages(he, images, args, std::nullopt);
+    clean.layer1.clear();
+    clean.outputs = args.nnPacked
+        ? forwardPacked(he, clean.input, encoded, args.logDelta,
+                        clean.hidden_layer, clean.reduceSum_layer, args, std::nullopt)
+        : forward(he, clean.input, encoded, args.logSlots, args.logDelta,
+                  clean.hidden_layer, clean.reduceSum_layer, args, std::nullopt,
+                  &clean.layer1);
+    clean.decrypted = decryptLogits(he, clean.outputs);
+    clean.logits = decodeAll(he, encoded, clean.decrypted, args, images.size());
+    clean.valid = true;
+}
+
+// decrypt/decode faults: only outputs[faulty] changes, so decrypt and
+// decode that one and keep the clean logits of the others
+static vector<vector<double>> lateStageLogits(HEEnv& he, EncodedWeights& encoded,
+        const NNCleanCache& clean, CampaignArgs& args, size_t faulty,
+        size_t batch, const IterationArgs& iterArgs)
+{
+    Plaintext dec;
+    if (args.stage == "decode") {
+        dec = clean.decrypted[faulty];
+        SwitchBit(dec.mx[iterArgs.coeff], iterArgs.bit);
+    } else {
+        Ciphertext ct = clean.outputs[faulty];
+        if (args.stage == "decrypt_c0")
+            SwitchBit(ct.bx[iterArgs.coeff], iterArgs.bit);
+        else
+            SwitchBit(ct.ax[iterArgs.coeff], iterArgs.bit);
+        ProfileScope scope(he.profiler, "client.decrypt");
+        dec = he.scheme.decryptMsg(he.sk, ct);
+    }
+
+    vector<Plaintext> one{std::move(dec)};
+    auto column = decodeAll(he, encoded, one, args, batch);
+
+    if (args.nnPacked)
+        return column;
+    auto logits = clean.logits;
+    for (size_t b = 0; b < batch; ++b)
+        logits[b][faulty] = column[b][0];
+    return logits;
+}
+
+// preds[b] = argmax of logits[b]; detected refers to image 0
+static IterationResult predictFromLogits(const vector<vector<double>>& logits,
+        size_t targetValue, vector<size_t>& preds, size_t verbose)
+{
+    size_t batch = logits.size();
+    preds.assign(batch, 0);
+    for(size_t b=0;b<batch;++b){
+        double best = logits[b][0];
+        for(size_t i=1;i<logits[b].size();++i){
+            if(logits[b][i] > best){
+                best = logits[b][i];
+                preds[b] = i;
+            }
+        }
+    }
+    size_t pred = preds[0];
+    IterationResult res;
+    res.detected = (pred == targetValue);
+    if(verbose){
+        cout << "\nPrediction: " << pred
+             << "\nTarget:     " << targetValue
+             << endl;
+
+        if(pred == targetValue)
+            cout << "✔ Correct\n";
+        else
+            cout << "✘ Incorrect\n";
+    }
+    return res;
+}
+
+IterationResult run_iteration_NN_batch(HEEnv& he, EncodedWeights& encoded,
+        const vector<vector<double>>& images, CampaignArgs& args, size_t targetValue,
+        vector<size_t>& preds,
+        uint32_t &hidden_layer,  uint32_t &reduceSum_layer,
+        std::optional<IterationArgs> iterArgs, const NNCleanCache* clean ){
+
+    size_t logSlots = args.logSlots;
+    size_t batch = images.size();
+    size_t logP = args.logDelta;
+    size_t verbose = args.verbose;
+
+    // The packed forward returns every logit in one ciphertext
+    size_t faulty = args.nnPacked ? 0 : targetValue;
+
+    // Clean run: the cache already has the logits
+    if (clean && clean->valid && !iterArgs) {
+        hidden_layer = clean->hidden_layer;
+        reduceSum_layer = clean->reduceSum_layer;
+        return predictFromLogits(clean->logits, targetValue, preds, verbose);
+    }
+
+    const bool cached = clean && clean->valid && iterArgs;
+    if (cached && isLateStage(args)) {
+        auto logits = lateStageLogits(he, encoded, *clean, args, faulty, batch, *iterArgs);
+        return predictFromLogits(logits, targetValue, preds, verbose);
+    }
+
+    // hidden_layer/cheby_tanh3 faults only touch one neuron: start from
+    // the clean input and patch the clean outputs
+    const bool oneNeuron = cached && isOneNeuronStage(args);
+
+    Ciphertext c;
+    if (!oneNeuron)
+        c = encryptImages(he, images, args, iterArgs);
 
     if(args.verbose)
         cout << "Running encrypted inference..." << endl;
-    auto outputs = forward(
+    // reduceSum works on logSlots (one block), so every block sums
+    // into its own first slot.
+    auto outputs = oneNeuron
+        ? forwardOneNeuron(he, *clean, encoded, logSlots, logP, hidden_layer, reduceSum_layer, args, iterArgs)
+        : args.nnPacked
+        ? forwardPacked(he, c, encoded, logP, hidden_layer, reduceSum_layer, args, iterArgs)
+        : forward(
         he,
         c,
         encoded,
@@ -447,39 +978,26 @@ IterationResult run_iteration_NN(HEEnv& he, EncodedWeights& encoded,
     // I make a bit flip on the cipher with the target value
     if (iterArgs) {
         if (args.stage == "decrypt_c0") {
-            SwitchBit(outputs[targetValue].bx[iterArgs->coeff], iterArgs->bit);
+            SwitchBit(outputs[faulty].bx[iterArgs->coeff], iterArgs->bit);
         } else if (args.stage == "decrypt_c1") {
-            SwitchBit(outputs[targetValue].ax[iterArgs->coeff], iterArgs->bit);
+            SwitchBit(outputs[faulty].ax[iterArgs->coeff], iterArgs->bit);
         }
     }
     auto logitsDec = decryptLogits(he, outputs);
 
     if (iterArgs && args.stage == "decode") {
-        SwitchBit(logitsDec[targetValue].mx[iterArgs->coeff], iterArgs->bit);
+        SwitchBit(logitsDec[faulty].mx[iterArgs->coeff], iterArgs->bit);
     }
 
-    auto logits = decodeLogits(he, logitsDec);
-
-    size_t pred = 0;
-    double best = logits[0];
-
-    for(size_t i=1;i<logits.size();++i){
-        if(logits[i] > best){
-            best = logits[i];
-            pred = i;
-        }
-    }
-    IterationResult res;
-    res.detected = (pred == targetValue);
-    if(verbose){
-        cout << "\nPrediction: " << pred
-             << "\nTarget:     " << targetValue
-             << endl;
+    auto logits = decodeAll(he, encoded, logitsDec, args, batch);
+    return predictFromLogits(logits, targetValue, preds, verbose);
+}
 
-        if(pred == targetValue)
-            cout << "✔ Correct\n";
-        else
-            cout << "✘ Incorrect\n";
-    }
-    return res;
+IterationResult run_iteration_NN(HEEnv& he, EncodedWeights& encoded,
+        const vector<double>& vals, CampaignArgs& args, size_t targetValue,
+        uint32_t &hidden_layer,  uint32_t &reduceSum_layer,
+        std::optional<IterationArgs> iterArgs ){
+    vector<size_t> preds;
+    return run_iteration_NN_batch(he, encoded, {vals}, args, targetValue,
+                                  preds, hidden_layer, reduceSum_layer, iterArgs);
 }
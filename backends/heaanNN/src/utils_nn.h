@@ -6,22 +6,43 @@
 #include <cassert>
 #include "campaign_helper.h"
 #include "backend_interface.h"
+#include "backend_heaan.h"
 #include "utils_ckks.h"
+#include "nn_packing.h"
+#include "parallel_utils.h"
+#include "nn_cache.h"
+#include "nn_profiler.h"
 
 struct HEEnv {
     Context context;
     SecretKey sk;
     Scheme scheme;
     vector<long> rotIdx;
+    // Set by --profile; null keeps the forward unprofiled
+    NNProfiler* profiler = nullptr;
 
-    HEEnv(long logN, long logQ, long h)
+    // Only the rotation keys of reduceSum over 2^logBlock slot blocks.
+    // HEAAN has no hoisted rotations, and the hidden_layer injection hooks
+    // address single radix-2 steps, so the schedule stays 1, 2, .., 2^(logBlock-1).
+    HEEnv(long logN, long logQ, long h, long logBlock)
         : context(logN, logQ),
           sk(logN, h),
           scheme(sk, context)
     {
-        for (long p = 1; p <= 512; p <<= 1) {
-            rotIdx.push_back(p);
-            scheme.addLeftRotKey(sk, p);
+        for (long i = 0; i < logBlock; ++i) {
+            rotIdx.push_back(1L << i);
+            scheme.addLeftRotKey(sk, 1L << i);
+        }
+    }
+
+    // Left rotation keys for steps not generated yet (packedRotations)
+    void addRotKeys(const std::vector<int>& steps)
+    {
+        for (int r : steps) {
+            if (std::find(rotIdx.begin(), rotIdx.end(), r) != rotIdx.end())
+                continue;
+            rotIdx.push_back(r);
+            scheme.addLeftRotKey(sk, r);
         }
     }
 };
@@ -30,8 +51,33 @@ struct EncodedWeights {
     vector<ZZX> W1;
     vector<double> b1;
 
-    vector<vector<ZZX>> W2;
+    vector<vector<double>> W2;
     vector<double> b2;
+
+    // Packed forward (encodeWeightsPacked): W1 diagonals in giant-major
+    // order, biases and W2 laid out as in nn_packing.h
+    PackedMLPLayout layout{};
+    vector<ZZX> W1diag;
+    ZZX b1Packed;
+    ZZX W2Packed;
+    ZZX b2Packed;
+};
+
+// Clean forward state of one image batch (buildCleanCache). hidden_layer
+// and cheby_tanh3 faults change a single neuron, so run_iteration_NN_batch
+// recomputes that neuron and patches these outputs instead of redoing the
+// whole network. decrypt/decode faults only touch outputs[targetValue]:
+// that one is decrypted and decoded again, the other logits are reused.
+// Without iterArgs, run_iteration_NN_batch predicts straight from logits.
+struct NNCleanCache {
+    bool valid = false;
+    uint32_t hidden_layer = 0;      // as drawn by the clean forward
+    uint32_t reduceSum_layer = 0;
+    Ciphertext input;
+    vector<Ciphertext> layer1;      // empty for nnPacked
+    vector<Ciphertext> outputs;
+    vector<Plaintext> decrypted;
+    vector<vector<double>> logits;  // logits[b][o]
 };
 
 
@@ -42,7 +88,21 @@ EncodedWeights encodeWeights(
     const vector<vector<double>>& W2,
     const vector<double>& b2,
     long slots,
-    long logP
+    long logP,
+    long blockSize = 0,  // W1 is repeated every blockSize slots (0 = once)
+    const NNCache* cache = nullptr  // load/store the encoded polynomials there
+);
+
+// Weights for forwardPacked over one block of `slots` slots (nnBatch 1)
+EncodedWeights encodeWeightsPacked(
+    HEEnv& he,
+    const vector<vector<double>>& W1,
+    const vector<double>& b1,
+    const vector<vector<double>>& W2,
+    const vector<double>& b2,
+    long slots,
+    long logP,
+    const NNCache* cache = nullptr
 );
 
 Ciphertext encryptInput(
@@ -53,12 +113,14 @@ Ciphertext encryptInput(
     long logQ
 );
 
+// Sums each block of 2^logSlots slots into its first slot; the hidden_layer
+// hooks (op_step 4-11) hit level reduceSum_layer, none if >= logSlots.
 void reduceSum(
     HEEnv& he,
     Ciphertext& ct,
     long logSlots,
-    uint32_t &reduceSum_layer,
-    CampaignArgs& args, std::optional<IterationArgs> iterArgs
+    CampaignArgs& args,
+    uint32_t reduceSum_layer, std::optional<IterationArgs> iterArgs
 );
 
 vector<Plaintext> decryptLogits(
@@ -71,6 +133,22 @@ vector<double> decodeLogits(
     vector<Plaintext>& outs
 );
 
+// Packed forward: logit o sits at slot o*stride of the single output
+vector<double> decodeLogitsPacked(
+    HEEnv& he,
+    Plaintext& pt,
+    size_t stride,
+    size_t outputs
+);
+
+// logits[b][o] of image b, read from slot b*blockSize of each output
+vector<vector<double>> decodeLogitsBatch(
+    HEEnv& he,
+    vector<Plaintext>& outs,
+    size_t blockSize,
+    size_t batch
+);
+
 
 bool loadMnistNormRowByIndex(const std::string &csvPath, size_t rowIndex,
                          size_t &outLabel, std::vector<double> &pixelsOut);
@@ -86,6 +164,24 @@ IterationResult run_iteration_NN(HEEnv& he, EncodedWeights& encoded,
         std::optional<IterationArgs> iterArgs=std::nullopt
 );
 
+// Same inference with images[b] packed in slot block b (1 << logSlots slots
+// each). preds[b] is the prediction of image b; detected refers to image 0.
+IterationResult run_iteration_NN_batch(HEEnv& he, EncodedWeights& encoded,
+        const vector<vector<double>>& images, CampaignArgs& args, size_t targetValue,
+        vector<size_t>& preds,
+        uint32_t &hidden_layer, uint32_t &reduceSum_layer,
+        std::optional<IterationArgs> iterArgs=std::nullopt,
+        const NNCleanCache* clean=nullptr
+);
+
+// Fills clean for images (no faults)
+void buildCleanCache(HEEnv& he, EncodedWeights& encoded,
+        const vector<vector<double>>& images, CampaignArgs& args,
+        NNCleanCache& clean);
+
+// Whether run_iteration_NN_batch can use a clean cache for args.stage
+bool cleanCacheApplies(const CampaignArgs& args);
+
 Ciphertext chebyTanh3(
     HEEnv& he,
     Ciphertext c,
@@ -106,5 +202,20 @@ vector<Ciphertext> forward(
     long logP,
     uint32_t &hidden_layer,
     uint32_t &reduceSum_layer,
+    CampaignArgs& args, std::optional<IterationArgs> iterArgs,
+    vector<Ciphertext>* layer1Out = nullptr
+);
+
+// Same network with the packed layout of nn_packing.h: one ciphertext per
+// layer and a single activation. Returns one ciphertext with logit o at
+// slot o*HIDDEN. hidden_layer is the diagonal the hidden_layer hooks hit and
+// reduceSum_layer the level of the stride sum.
+vector<Ciphertext> forwardPacked(
+    HEEnv& he,
+    Ciphertext& c,
+    EncodedWeights& ew,
+    long logP,
+    uint32_t &hidden_layer,
+    uint32_t &reduceSum_layer,
     CampaignArgs& args, std::optional<IterationArgs> iterArgs
 );
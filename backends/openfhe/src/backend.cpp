@@ -2,6 +2,14 @@
 #include "attack_mode.h"
 #include "constants-defs.h"
 #include "utils_ckks.h"
+#include "campaign_logger.h"
+#include "snapshot_store.h"
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+#include <fstream>
+#include <sstream>
 
 std::vector<double> get_reference_output(const BackendContext* bctx)
 {
@@ -68,6 +76,105 @@ ScalingTechnique toScalingTechnique(const std::string& s) {
     throw std::invalid_argument("Unknown scaling technique: " + s);
 }
 
+PRNG& thread_prng(const OpenFHEContext& ctx)
+{
+    // GetPRNG() is threadprivate in OpenFHE: each thread gets its own
+    // generator, which only has to be seeded once per context. setup_campaign
+    // always seeds, since a new context may reuse the address of an old one.
+    thread_local const OpenFHEContext* seededFor = nullptr;
+    thread_local uint64_t seededWith = 0;
+    PRNG& prng = lbcrypto::PseudoRandomNumberGenerator::GetPRNG();
+    if (seededFor != &ctx || seededWith != ctx.prngSeed) {
+        prng.SetSeed(ctx.prngSeed);
+        seededFor = &ctx;
+        seededWith = ctx.prngSeed;
+    }
+    return prng;
+}
+
+uint64_t secret_key_fingerprint(const PrivateKey<DCRTPoly>& sk)
+{
+    uint64_t h = FNV1A_OFFSET;
+    for (const auto& tower : sk->GetPrivateElement().GetAllElements()) {
+        for (uint32_t j = 0; j < tower.GetLength(); ++j) {
+            uint64_t v = tower[j].ConvertToInt();
+            h = fnv1a64(&v, sizeof(v), h);
+        }
+    }
+    return h;
+}
+
+// Resident size of a key-switching key: its a and b digit polynomials
+static size_t eval_key_bytes(const EvalKey<DCRTPoly>& key)
+{
+    size_t words = 0;
+    for (const auto* polys : {&key->GetAVector(), &key->GetBVector()})
+        for (const auto& p : *polys)
+            words += static_cast<size_t>(p.GetNumOfElements()) * p.GetRingDimension();
+    return words * sizeof(uint64_t);
+}
+
+std::unique_ptr<RotationKeyCache> make_rotation_key_cache(
+        const CryptoContext<DCRTPoly>& cc,
+        const PrivateKey<DCRTPoly>& sk,
+        const std::string& contextId,
+        const RotationKeyConfig& cfg)
+{
+    // OpenFHE stores rotation keys by automorphism index, per key tag
+    const std::string tag = sk->GetKeyTag();
+    auto autoIndex = [cc](int step) {
+        return cc->FindAutomorphismIndex(static_cast<uint32_t>(step));
+    };
+
+    RotationKeyHooks hooks;
+    hooks.generate = [cc, sk, tag, autoIndex](int step) {
+        cc->EvalAtIndexKeyGen(sk, {step});
+        return eval_key_bytes(cc->GetEvalAutomorphismKeyMap(tag).at(autoIndex(step)));
+    };
+    hooks.save = [cc, tag, autoIndex](int step, const std::string& path) {
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error("RotationKeyCache: no se pudo crear " + path);
+        Serial::Serialize(cc->GetEvalAutomorphismKeyMap(tag).at(autoIndex(step)), f, SerType::BINARY);
+        if (!f)
+            throw std::runtime_error("RotationKeyCache: fallo al escribir " + path);
+    };
+    hooks.load = [cc, tag, autoIndex](int step, const std::string& path) -> size_t {
+        std::ifstream f(path, std::ios::binary);
+        EvalKey<DCRTPoly> key;
+        try {
+            Serial::Deserialize(key, f, SerType::BINARY);
+        } catch (const std::exception&) {
+            return 0;   // truncated or foreign file: generate again
+        }
+        if (!key)
+            return 0;
+        auto keys = std::make_shared<std::map<uint32_t, EvalKey<DCRTPoly>>>();
+        (*keys)[autoIndex(step)] = key;
+        cc->InsertEvalAutomorphismKey(keys, tag);
+        return eval_key_bytes(key);
+    };
+    hooks.evict = [cc, tag, autoIndex](int step) {
+        cc->GetEvalAutomorphismKeyMap(tag).erase(autoIndex(step));
+    };
+    return std::make_unique<RotationKeyCache>(contextId, cfg, std::move(hooks));
+}
+
+// What the doRot key depends on: the context parameters, the seed, the
+// secret key and the eval-mult key generated before it from the same PRNG
+static std::string rotation_key_context(const OpenFHEContext& ctx, const CampaignArgs& args)
+{
+    std::ostringstream os;
+    os << "openfhe logN=" << args.logN << " logQ=" << args.logQ
+       << " logDelta=" << args.logDelta << " logSlots=" << args.logSlots
+       << " mult_depth=" << args.mult_depth << " scaleTech=" << args.scaleTech
+       << " seed=" << args.seed << " doMul=" << args.doMul
+       << " sk=" << std::hex << secret_key_fingerprint(ctx.keys.secretKey);
+    return os.str();
+}
+
+static void prepare_snapshots(OpenFHEContext& ctx, const CampaignArgs& args, PRNG& prng);
+
 BackendContext* setup_campaign(const CampaignArgs& args)
 {
 
@@ -99,8 +206,9 @@ BackendContext* setup_campaign(const CampaignArgs& args)
     params.SetSecurityLevel(HEStd_NotSet);
     auto* ctx = new OpenFHEContext();
 
-    ctx->prng = &lbcrypto::PseudoRandomNumberGenerator::GetPRNG();
-    ctx->prng->SetSeed(args.seed);
+    ctx->prngSeed = args.seed;
+    PRNG& prng = thread_prng(*ctx);
+    prng.SetSeed(args.seed);
     ctx->cc = GenCryptoContext(params);
     ctx->cc->Enable(PKE);
     ctx->cc->Enable(KEYSWITCH);
@@ -111,58 +219,58 @@ BackendContext* setup_campaign(const CampaignArgs& args)
         ctx->cc->EvalMultKeyGen(ctx->keys.secretKey);
 
     if(args.doRot>0){
+        // Loaded from --rotKeyCache when another process already made it.
+        // The encryptions below replay the seed, so skipping the key's
+        // draws from prng does not change them.
         int32_t rotIndex = static_cast<int32_t>(1ULL << (args.doRot - 1));
-        ctx->cc->EvalAtIndexKeyGen(ctx->keys.secretKey, {rotIndex});
+        ctx->rotKeys = make_rotation_key_cache(
+            ctx->cc, ctx->keys.secretKey, rotation_key_context(*ctx, args),
+            {args.rotKeyCache, static_cast<size_t>(args.rotKeyBudgetMB) << 20, args.seed});
+        ctx->rotKeys->require({rotIndex});
     }
 
     compute_plain_io(args, ctx->baseInput, ctx->goldenOutput);
 
+    ctx->ptxtInput = ctx->cc->MakeCKKSPackedPlaintext(ctx->baseInput);
+    if (args.snapshots) {
+        prepare_snapshots(*ctx, args, prng);
+        return ctx;
+    }
+    prng.ResetToSeed();
+    ctx->cInput = ctx->cc->Encrypt(ctx->keys.publicKey, ctx->ptxtInput);
+    if(args.doAdd || args.doMul)
+        ctx->cClean = ctx->cc->Encrypt(ctx->keys.publicKey, ctx->ptxtInput);
+
     return ctx;
 }
 
-
-IterationResult run_iteration(BackendContext* bctx,
-              const CampaignArgs& args,
-              std::optional<IterationArgs> iterArgs)
+// Input ciphertext for one iteration. Only an encode-stage flip needs a new
+// encryption (same randomness as cInput, replayed on the caller's prng);
+// otherwise a copy of the cache.
+static Ciphertext<DCRTPoly> input_cipher(const OpenFHEContext& ctx, PRNG& prng,
+                                         const CampaignArgs& args,
+                                         const std::optional<IterationArgs>& iterArgs)
 {
-    auto& ctx = static_cast<OpenFHEContext&>(*bctx);
-
-    ctx.prng->ResetToSeed();
-    Plaintext result_bitFlip;
-    Plaintext ptxt = ctx.cc->MakeCKKSPackedPlaintext(ctx.baseInput);
-    Plaintext ptxt_clean;
     if (iterArgs && args.stage == "encode") {
+        Plaintext ptxt = std::make_shared<CKKSPackedEncoding>(
+            *std::static_pointer_cast<CKKSPackedEncoding>(ctx.ptxtInput));
         bitFlip(ptxt, args.withNTT,
                 iterArgs->limb,
                 iterArgs->coeff,
                 iterArgs->bit);
+        prng.ResetToSeed();
+        return ctx.cc->Encrypt(ctx.keys.publicKey, ptxt);
     }
+    return ctx.cInput->Clone();
+}
 
-    Ciphertext<DCRTPoly> c = ctx.cc->Encrypt(ctx.keys.publicKey, ptxt);
-    Ciphertext<DCRTPoly> c_clean;
-
-    if(args.doAdd || args.doMul){
-        ptxt_clean = ctx.cc->MakeCKKSPackedPlaintext(ctx.baseInput);
-        c_clean = ctx.cc->Encrypt(ctx.keys.publicKey, ptxt_clean);
-    }
-
-    if(args.doPlainMul){
-        ptxt_clean = ctx.cc->MakeCKKSPackedPlaintext(ctx.baseInput);
-    }
 
-    if (iterArgs) {
-        if (args.stage == "encrypt_c0") {
-            bitFlip(c, args.withNTT, 0,
-                    iterArgs->limb,
-                    iterArgs->coeff,
-                    iterArgs->bit);
-        } else if (args.stage == "encrypt_c1") {
-            bitFlip(c, args.withNTT, 1,
-                    iterArgs->limb,
-                    iterArgs->coeff,
-                    iterArgs->bit);
-        }
-    }
+// Server pipeline of the campaign (doAdd, doPlainMul, doMul, doScalarMul, doRot)
+static Ciphertext<DCRTPoly> server_ops(const OpenFHEContext& ctx, const CampaignArgs& args,
+                                       Ciphertext<DCRTPoly> c)
+{
+    const Ciphertext<DCRTPoly>& c_clean = ctx.cClean;
+    const Plaintext& ptxt_clean = ctx.ptxtInput;
 
     for (uint32_t i = 0; i < args.doAdd; ++i)
         c = ctx.cc->EvalAdd(c, c_clean);
@@ -182,67 +290,283 @@ IterationResult run_iteration(BackendContext* bctx,
         int32_t rotIndex = static_cast<int32_t>(1ULL << (args.doRot - 1));
         c = ctx.cc->EvalRotate(c, rotIndex);
     }
+    return c;
+}
 
-    if (iterArgs) {
-        if (args.stage == "decrypt_c0") {
-            bitFlip(c, args.withNTT, 0,
-                    iterArgs->limb,
-                    iterArgs->coeff,
-                    iterArgs->bit);
-        } else if (args.stage == "decrypt_c1") {
-            bitFlip(c, args.withNTT, 1,
-                    iterArgs->limb,
-                    iterArgs->coeff,
-                    iterArgs->bit);
+// Clean output of server_ops when the fault comes after the server (or
+// there is none) and setup_campaign loaded or built the snapshot; else null
+static Ciphertext<DCRTPoly> server_snapshot(const OpenFHEContext& ctx, const CampaignArgs& args,
+                                            const std::optional<IterationArgs>& iterArgs)
+{
+    if (!ctx.cServer)
+        return nullptr;
+    if (iterArgs && args.stage != "decrypt_c0" && args.stage != "decrypt_c1")
+        return nullptr;
+    return ctx.cServer->Clone();
+}
+
+// Raw layout of a ciphertext: level, noise degree, scaling factor, slots,
+// then per element its format, towers, ring dimension and the towers' words
+static void put_cipher(SnapshotWriter& w, const Ciphertext<DCRTPoly>& c)
+{
+    const auto& elems = c->GetElements();
+    w.put(c->GetLevel());
+    w.put(c->GetNoiseScaleDeg());
+    w.putDouble(c->GetScalingFactor());
+    w.put(c->GetSlots());
+    w.put(elems.size());
+    for (const auto& e : elems) {
+        w.put(e.GetFormat() == Format::EVALUATION ? 1 : 0);
+        w.put(e.GetNumOfElements());
+        w.put(e.GetRingDimension());
+        for (const auto& tower : e.GetAllElements()) {
+            const uint32_t n = tower.GetLength();
+            uint64_t* out = w.extend(n);
+            for (uint32_t j = 0; j < n; ++j)
+                out[j] = tower[j].ConvertToInt();
         }
     }
+}
 
-    ctx.cc->Decrypt(ctx.keys.secretKey, c, &result_bitFlip);
+// Rebuilds the ciphertext on the towers of ctx.cc (the moduli come from the
+// context, the snapshot only holds residues)
+static Ciphertext<DCRTPoly> get_cipher(const OpenFHEContext& ctx, SnapshotReader& r)
+{
+    auto c = std::make_shared<CiphertextImpl<DCRTPoly>>(ctx.keys.publicKey);
+    const size_t level = r.get();
+    const size_t noiseScaleDeg = r.get();
+    const double scalingFactor = r.getDouble();
+    const uint32_t slots = static_cast<uint32_t>(r.get());
+    const size_t nElems = r.get();
+
+    const auto params = ctx.cc->GetElementParams();
+    std::vector<DCRTPoly> elems;
+    for (size_t e = 0; e < nElems; ++e) {
+        const Format fmt = r.get() ? Format::EVALUATION : Format::COEFFICIENT;
+        const size_t towers = r.get();
+        const uint32_t n = static_cast<uint32_t>(r.get());
+        DCRTPoly p(params, fmt, true);
+        if (towers > p.GetNumOfElements() || n != p.GetRingDimension())
+            throw std::runtime_error("snapshot: el cifrado no coincide con el contexto");
+        p.DropLastElements(p.GetNumOfElements() - towers);
+        for (size_t t = 0; t < towers; ++t) {
+            NativePoly& tower = p.GetAllElements()[t];
+            const uint64_t* in = r.take(n);
+            for (uint32_t j = 0; j < n; ++j)
+                tower[j] = NativeInteger(in[j]);
+        }
+        elems.push_back(std::move(p));
+    }
+    c->SetElements(std::move(elems));
+    c->SetLevel(level);
+    c->SetNoiseScaleDeg(noiseScaleDeg);
+    c->SetScalingFactor(scalingFactor);
+    c->SetSlots(slots);
+    c->SetEncodingType(CKKS_PACKED_ENCODING);
+    return c;
+}
 
-    bool detected = SDCConfigHelper::WasSDCDetected(result_bitFlip);
+// Everything the clean pipeline depends on, plus the secret key: a snapshot
+// is only reused by processes that generated the same key
+static std::string snapshot_prefix(const OpenFHEContext& ctx, const CampaignArgs& args)
+{
+    const uint64_t skHash = secret_key_fingerprint(ctx.keys.secretKey);
+    std::ostringstream os;
+    os << "openfhe logN=" << args.logN << " logQ=" << args.logQ
+       << " logDelta=" << args.logDelta << " logSlots=" << args.logSlots
+       << " mult_depth=" << args.mult_depth << " scaleTech=" << args.scaleTech
+       << " seed=" << args.seed << " seed_input=" << args.seed_input
+       << " logMin=" << args.logMin << " logMax=" << args.logMax
+       << " sk=" << std::hex << skHash;
+    return os.str();
+}
 
-    result_bitFlip->SetLength(1 << args.logSlots);
+// Loads cInput/cClean and cServer from the store, or encrypts and runs
+// server_ops once and stores them
+static void prepare_snapshots(OpenFHEContext& ctx, const CampaignArgs& args, PRNG& prng)
+{
+    SnapshotStore store(args.results_dir + "/snapshots");
+    const std::string prefix = snapshot_prefix(ctx, args);
+
+    const std::string inputDesc = prefix + " state=input";
+    if (auto snap = store.load(inputDesc)) {
+        SnapshotReader r = snap->reader();
+        ctx.cInput = get_cipher(ctx, r);
+        ctx.cClean = get_cipher(ctx, r);
+    } else {
+        prng.ResetToSeed();
+        ctx.cInput = ctx.cc->Encrypt(ctx.keys.publicKey, ctx.ptxtInput);
+        ctx.cClean = ctx.cc->Encrypt(ctx.keys.publicKey, ctx.ptxtInput);
+        SnapshotWriter w;
+        put_cipher(w, ctx.cInput);
+        put_cipher(w, ctx.cClean);
+        store.store(inputDesc, w);
+    }
 
-    return {result_bitFlip->GetRealPackedValue(), detected};
+    std::ostringstream ops;
+    ops << prefix << " state=server add=" << args.doAdd << " pmul=" << args.doPlainMul
+        << " mul=" << args.doMul << " smul=" << args.doScalarMul << " rot=" << args.doRot;
+    const std::string serverDesc = ops.str();
+    if (auto snap = store.load(serverDesc)) {
+        SnapshotReader r = snap->reader();
+        ctx.cServer = get_cipher(ctx, r);
+    } else {
+        ctx.cServer = server_ops(ctx, args, ctx.cInput->Clone());
+        SnapshotWriter w;
+        put_cipher(w, ctx.cServer);
+        store.store(serverDesc, w);
+    }
 }
 
+// The delta path rebuilds the decryption itself (CRTInterpolate + Decode),
+// so it is limited to what that mirrors exactly: several towers (one tower
+// decrypts through NativePoly) and FIXEDMANUAL (no implicit rescale).
+static bool decrypt_delta_applies(const CampaignArgs& args)
+{
+    if (!args.decryptDelta || (args.stage != "decrypt_c0" && args.stage != "decrypt_c1"))
+        return false;
+    return toScalingTechnique(args.scaleTech) == ScalingTechnique::FIXEDMANUAL;
+}
 
-IterationChequer gen_cipher(BackendContext* bctx,
+static void build_decrypt_cache(OpenFHEContext& ctx, const CampaignArgs& args)
+{
+    ctx.cPreDecrypt = ctx.cServer ? ctx.cServer->Clone() : server_ops(ctx, args, ctx.cInput->Clone());
+    const auto& cv = ctx.cPreDecrypt->GetElements();
+    if (cv.size() != 2)
+        throw std::runtime_error("decryptDelta: se esperaba un cifrado de 2 elementos");
+
+    // Same as DecryptCore: s trimmed to the towers of the ciphertext
+    DCRTPoly s(ctx.keys.secretKey->GetPrivateElement());
+    s.DropLastElements(s.GetNumOfElements() - cv[0].GetNumOfElements());
+    s.SetFormat(Format::EVALUATION);
+    ctx.sEval = s;
+
+    DCRTPoly c0(cv[0]), c1(cv[1]);
+    c0.SetFormat(Format::EVALUATION);
+    c1.SetFormat(Format::EVALUATION);
+    DCRTPoly b = c0 + c1 * s;
+    b.SetFormat(Format::COEFFICIENT);
+    ctx.bCoeff = std::move(b);
+
+    c0.SetFormat(Format::COEFFICIENT);
+    c1.SetFormat(Format::COEFFICIENT);
+    s.SetFormat(Format::COEFFICIENT);
+    ctx.c0Coeff = std::move(c0);
+    ctx.c1Coeff = std::move(c1);
+    ctx.sCoeff = std::move(s);
+}
+
+// Decrypt of cPreDecrypt with one bit flipped in limb i of c0 or c1 (the
+// same flip bitFlip applies): only residue i of b changes, by delta for c0
+// and by delta*s for c1. A flip at or above log2(q_i) can leave the residue
+// >= q_i, which bitFlip keeps unreduced and Decrypt sees as is; the delta
+// would reduce it, so those flips return null and take the full Decrypt.
+static Plaintext decrypt_delta(const OpenFHEContext& ctx, const CampaignArgs& args,
+                               const IterationArgs& it)
+{
+    const size_t k = (args.stage == "decrypt_c0") ? 0 : 1;
+    const size_t i = it.limb, j = it.coeff;
+
+    DCRTPoly b(ctx.bCoeff);
+    NativePoly& bi = b.GetAllElements()[i];
+    const NativeInteger q = bi.GetModulus();
+    const uint32_t N = bi.GetLength();
+
+    // Residue before the flip, in the domain bitFlip works in
+    NativeInteger old;
+    if (args.withNTT)
+        old = ctx.cPreDecrypt->GetElements()[k].GetElementAtIndex(i)[j];
+    else
+        old = (k == 0 ? ctx.c0Coeff : ctx.c1Coeff).GetElementAtIndex(i)[j];
+    NativeInteger flipped(old.ConvertToInt() ^ (1ULL << it.bit));
+    if (flipped >= q)
+        return nullptr;
+    NativeInteger delta = flipped.ModSub(old, q);
+
+    if (args.withNTT) {
+        // One evaluation point changed: bring delta (times s there) back
+        // to coefficients with a single-tower INTT
+        NativePoly d(bi.GetParams(), Format::EVALUATION, true);
+        d[j] = (k == 0) ? delta : delta.ModMul(ctx.sEval.GetElementAtIndex(i)[j], q);
+        d.SetFormat(Format::COEFFICIENT);
+        bi += d;
+    } else if (k == 0) {
+        bi[j] = bi[j].ModAdd(delta, q);
+    } else {
+        // delta * X^j * s_i mod (X^N + 1): negacyclic shift of s_i
+        const NativePoly& si = ctx.sCoeff.GetElementAtIndex(i);
+        for (uint32_t t = 0; t < N; ++t) {
+            NativeInteger v = delta.ModMul(si[t], q);
+            uint32_t idx = t + j;
+            if (idx < N) bi[idx] = bi[idx].ModAdd(v, q);
+            else         bi[idx - N] = bi[idx - N].ModSub(v, q);
+        }
+    }
+
+    // Rest of CryptoContext::Decrypt for a CKKS ciphertext with several towers
+    const auto& c = ctx.cPreDecrypt;
+    Plaintext pt = PlaintextFactory::MakePlaintext(CKKS_PACKED_ENCODING,
+        c->GetElements()[0].GetParams(), ctx.cc->GetEncodingParams());
+    pt->GetElement<Poly>() = b.CRTInterpolate();
+
+    auto ckks = std::static_pointer_cast<CKKSPackedEncoding>(pt);
+    ckks->SetNoiseScaleDeg(c->GetNoiseScaleDeg());
+    ckks->SetLevel(c->GetLevel());
+    ckks->SetScalingFactor(c->GetScalingFactor());
+    ckks->SetSlots(c->GetSlots());
+    const auto params = std::dynamic_pointer_cast<CryptoParametersCKKSRNS>(ctx.cc->GetCryptoParameters());
+    ckks->Decode(c->GetNoiseScaleDeg(), c->GetScalingFactor(),
+                 params->GetScalingTechnique(), params->GetExecutionMode());
+    return pt;
+}
+
+IterationResult run_iteration(BackendContext* bctx,
               const CampaignArgs& args,
               std::optional<IterationArgs> iterArgs)
 {
     auto& ctx = static_cast<OpenFHEContext&>(*bctx);
 
-    ctx.prng->ResetToSeed();
     Plaintext result_bitFlip;
-    Plaintext ptxt = ctx.cc->MakeCKKSPackedPlaintext(ctx.baseInput);
-    Plaintext ptxt_clean;
-    if (iterArgs && args.stage == "encode") {
-        bitFlip(ptxt, args.withNTT,
-                iterArgs->limb,
-                iterArgs->coeff,
-                iterArgs->bit);
+    if (iterArgs && decrypt_delta_applies(args)) {
+        // Concurrent iterations wait for the first one to build it
+        std::call_once(ctx.decryptCacheOnce, build_decrypt_cache, std::ref(ctx), std::cref(args));
+        if (ctx.bCoeff.GetNumOfElements() > 1)
+            result_bitFlip = decrypt_delta(ctx, args, *iterArgs);
+        if (result_bitFlip) {
+            bool detected = SDCConfigHelper::WasSDCDetected(result_bitFlip);
+            result_bitFlip->SetLength(1 << args.logSlots);
+            return {result_bitFlip->GetRealPackedValue(), detected};
+        }
     }
 
-    Ciphertext<DCRTPoly> c = ctx.cc->Encrypt(ctx.keys.publicKey, ptxt);
-    Ciphertext<DCRTPoly> c_clean;
-
-    if(args.doAdd || args.doMul){
-        ptxt_clean = ctx.cc->MakeCKKSPackedPlaintext(ctx.baseInput);
-        c_clean = ctx.cc->Encrypt(ctx.keys.publicKey, ptxt_clean);
-    }
+    Ciphertext<DCRTPoly> c = server_snapshot(ctx, args, iterArgs);
+    if (!c) {
+        c = input_cipher(ctx, thread_prng(ctx), args, iterArgs);
+
+        if (iterArgs) {
+            if (args.stage == "encrypt_c0") {
+                bitFlip(c, args.withNTT, 0,
+                        iterArgs->limb,
+                        iterArgs->coeff,
+                        iterArgs->bit);
+            } else if (args.stage == "encrypt_c1") {
+                bitFlip(c, args.withNTT, 1,
+                        iterArgs->limb,
+                        iterArgs->coeff,
+                        iterArgs->bit);
+            }
+        }
 
-    if(args.doPlainMul){
-        ptxt_clean = ctx.cc->MakeCKKSPackedPlaintext(ctx.baseInput);
+        c = server_ops(ctx, args, c);
     }
 
     if (iterArgs) {
-        if (args.stage == "encrypt_c0") {
+        if (args.stage == "decrypt_c0") {
             bitFlip(c, args.withNTT, 0,
                     iterArgs->limb,
                     iterArgs->coeff,
                     iterArgs->bit);
-        } else if (args.stage == "encrypt_c1") {
+        } else if (args.stage == "decrypt_c1") {
             bitFlip(c, args.withNTT, 1,
                     iterArgs->limb,
                     iterArgs->coeff,
@@ -250,23 +574,60 @@ IterationChequer gen_cipher(BackendContext* bctx,
         }
     }
 
-    for (uint32_t i = 0; i < args.doAdd; ++i)
-        c = ctx.cc->EvalAdd(c, c_clean);
+    ctx.cc->Decrypt(ctx.keys.secretKey, c, &result_bitFlip);
 
-    for (uint32_t i = 0; i < args.doPlainMul; ++i)
-        c = ctx.cc->EvalMult(c, ptxt_clean);
+    bool detected = SDCConfigHelper::WasSDCDetected(result_bitFlip);
 
-    for (uint32_t i = 0; i < args.doMul; ++i)
-        c = ctx.cc->EvalMult(c, c_clean);
+    result_bitFlip->SetLength(1 << args.logSlots);
 
-    if(args.doScalarMul>0){
-        double scalar = static_cast<double>(args.doScalarMul);
-        c = ctx.cc->EvalMult(c, scalar);
-    }
+    return {result_bitFlip->GetRealPackedValue(), detected};
+}
 
-    if(args.doRot){
-        int32_t rotIndex = static_cast<int32_t>(1ULL << (args.doRot - 1));
-        c = ctx.cc->EvalRotate(c, rotIndex);
+BitflipResult evaluate_flip(BackendContext* bctx,
+                            const CampaignArgs& args,
+                            const IterationResult& golden,
+                            const IterationArgs& iterArgs)
+{
+    const size_t slots = (size_t)(1 << args.logSlots);
+    IterationResult res = run_iteration(bctx, args, iterArgs);
+    CKKSAccuracyMetrics exp_metrics = EvaluateCKKSAccuracy(golden.values, res.values);
+    BitflipResult r{};
+    r.limb = iterArgs.limb;
+    r.coeff = iterArgs.coeff;
+    r.bit = iterArgs.bit;
+    r.norm2 = exp_metrics.l2_rel_error;     // ||error||_2 / ||golden||_2
+    r.rel_error = exp_metrics.linf_abs_error;
+    r.is_sdc = res.detected;
+    r.stats = categorize_slots_relative(golden.values, res.values, slots);
+    return r;
+}
+
+
+Ciphertext<DCRTPoly> faulty_cipher(BackendContext* bctx,
+              const CampaignArgs& args,
+              std::optional<IterationArgs> iterArgs)
+{
+    auto& ctx = static_cast<OpenFHEContext&>(*bctx);
+
+    Ciphertext<DCRTPoly> c = server_snapshot(ctx, args, iterArgs);
+    if (!c) {
+        c = input_cipher(ctx, thread_prng(ctx), args, iterArgs);
+
+        if (iterArgs) {
+            if (args.stage == "encrypt_c0") {
+                bitFlip(c, args.withNTT, 0,
+                        iterArgs->limb,
+                        iterArgs->coeff,
+                        iterArgs->bit);
+            } else if (args.stage == "encrypt_c1") {
+                bitFlip(c, args.withNTT, 1,
+                        iterArgs->limb,
+                        iterArgs->coeff,
+                        iterArgs->bit);
+            }
+        }
+
+        c = server_ops(ctx, args, c);
     }
 
     if (iterArgs) {
@@ -282,6 +643,17 @@ IterationChequer gen_cipher(BackendContext* bctx,
                     iterArgs->bit);
         }
     }
+    return c;
+}
+
+IterationChequer gen_cipher(BackendContext* bctx,
+              const CampaignArgs& args,
+              std::optional<IterationArgs> iterArgs)
+{
+    auto& ctx = static_cast<OpenFHEContext&>(*bctx);
+
+    Plaintext result_bitFlip;
+    Ciphertext<DCRTPoly> c = faulty_cipher(bctx, args, iterArgs);
     ctx.cc->Decrypt(ctx.keys.secretKey, c, &result_bitFlip);
 
     bool detected = SDCConfigHelper::WasSDCDetected(result_bitFlip);
@@ -290,3 +662,35 @@ IterationChequer gen_cipher(BackendContext* bctx,
 
     return {result_bitFlip->GetRealPackedValue(), detected, c};
 }
+
+void set_ska_detector(const CampaignArgs& args, double thresholdBits)
+{
+    auto attackModeOF =
+        args.openfhe_attack_mode
+            ? to_openfhe_attack_mode(*args.openfhe_attack_mode)
+            : SecretKeyAttackMode::CompleteInjection;
+    SDCConfigHelper::SetGlobalConfig(SDCConfigHelper::MakeConfig(false, attackModeOF, thresholdBits));
+}
+
+void disable_ska_detector()
+{
+    SDCConfigHelper::SetGlobalConfig(SDCConfigHelper::MakeConfig(false, SecretKeyAttackMode::Disabled));
+}
+
+void destroy_campaign(BackendContext* ctx) {
+    delete ctx;
+}
+
+IntegrityStats cipher_integrity(const Ciphertext<DCRTPoly>& c)
+{
+    // NativeInteger is a bare uint64_t, so a tower is read as raw words
+    static_assert(sizeof(NativeInteger) == sizeof(uint64_t), "NativeInteger no es de 64 bits");
+    IntegrityStats stats;
+    for (const auto& e : c->GetElements()) {
+        for (const auto& tower : e.GetAllElements()) {
+            const auto* words = reinterpret_cast<const uint64_t*>(&tower.GetValues()[0]);
+            stats.merge(check_limb(words, tower.GetLength(), tower.GetModulus().ConvertToInt()));
+        }
+    }
+    return stats;
+}
@@ -1,16 +1,65 @@
 #include "openfhe.h"
 #include "backend_interface.h"
+#include "cipher_integrity.h"
+#include "rotation_key_cache.h"
+#include <memory>
+#include <mutex>
 using namespace lbcrypto;
 
+// Everything here is written by setup_campaign (and the decrypt cache, once)
+// and only read by run_iteration, so several threads can run iterations on
+// one context: cc, the eval-mult and rotation keys are shared read-only.
+// The encryption randomness is not: see thread_prng.
 struct OpenFHEContext final : BackendContext {
     CryptoContext<DCRTPoly> cc;
     KeyPair<DCRTPoly> keys;
     std::vector<double> baseInput;
     std::vector<double> goldenOutput;
-    PRNG* prng;
+    // Seed of every thread's PRNG stream (args.seed)
+    uint64_t prngSeed = 0;
+
+    // Clean encoding and ciphertexts built once in setup_campaign.
+    // cClean is the second encryption after ResetToSeed, like the operand
+    // run_iteration used to encrypt after the input.
+    Plaintext ptxtInput;
+    Ciphertext<DCRTPoly> cInput;
+    Ciphertext<DCRTPoly> cClean;
+    // --snapshots: clean output of server_ops, loaded from or written to the
+    // snapshot store. Decrypt stages start from it (null without snapshots).
+    Ciphertext<DCRTPoly> cServer;
+    // doRot key, through the rotation-key cache (--rotKeyCache)
+    std::unique_ptr<RotationKeyCache> rotKeys;
+
+    // --decryptDelta: clean state of the decrypt_c0/decrypt_c1 stages, built
+    // on the first such iteration. A flip in limb i only changes residue i
+    // of b = c0 + c1*s, so only that residue is recomputed.
+    std::once_flag decryptCacheOnce;
+    Ciphertext<DCRTPoly> cPreDecrypt;  // clean ciphertext handed to Decrypt
+    DCRTPoly c0Coeff, c1Coeff;         // its elements, COEFFICIENT
+    DCRTPoly sEval, sCoeff;            // s at the ciphertext level
+    DCRTPoly bCoeff;                   // clean c0 + c1*s, COEFFICIENT
 };
 
 
+// PRNG of the calling thread, seeded with ctx.prngSeed the first time this
+// thread uses ctx. OpenFHE keeps one generator per thread and Encrypt draws
+// from it, so ResetToSeed() on this handle replays the setup randomness for
+// this thread only.
+PRNG& thread_prng(const OpenFHEContext& ctx);
+
+// FNV-1a of the residues of sk: tells apart keys of equal parameters
+uint64_t secret_key_fingerprint(const PrivateKey<DCRTPoly>& sk);
+
+// Rotation-key cache over OpenFHE's eval-automorphism keys of sk's tag.
+// contextId must name everything the keys depend on (parameters, seed,
+// secret_key_fingerprint). Generation draws from the calling thread's PRNG.
+std::unique_ptr<RotationKeyCache> make_rotation_key_cache(
+        const CryptoContext<DCRTPoly>& cc,
+        const PrivateKey<DCRTPoly>& sk,
+        const std::string& contextId,
+        const RotationKeyConfig& cfg);
+
+
 struct IterationChequer {
     std::vector<double> values;
     bool detected;
@@ -21,3 +70,20 @@ struct IterationChequer {
  IterationChequer gen_cipher(BackendContext* bctx,
               const CampaignArgs& args,
                 std::optional<IterationArgs> iterArgs = std::nullopt);
+
+// Ciphertext handed to Decrypt in run_iteration, with the flip of args.stage
+// applied (gen_cipher without the decryption)
+Ciphertext<DCRTPoly> faulty_cipher(BackendContext* bctx,
+              const CampaignArgs& args,
+              std::optional<IterationArgs> iterArgs = std::nullopt);
+
+// Global SDC config for the next decryptions: args' SKA attack mode at
+// thresholdBits, exceptions off (as in setup_campaign)
+void set_ska_detector(const CampaignArgs& args, double thresholdBits);
+
+// Same with the SKA check off (SecretKeyAttackMode::Disabled): a plain Decrypt
+void disable_ska_detector();
+
+// Range and bit-uniformity statistics (cipher_integrity.h) of every limb of
+// both ciphertext elements, on the residues as stored (no format switch)
+IntegrityStats cipher_integrity(const Ciphertext<DCRTPoly>& c);
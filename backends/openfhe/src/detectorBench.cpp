@@ -0,0 +1,148 @@
+#include "openfhe.h"
+#include "campaign_helper.h"
+#include "campaign_registry.h"
+#include "backend_interface.h"
+#include "backend_openfhe.h"
+#include "detector_bench.h"
+#include "utils_ckks.h"
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+
+ExistingCampaignPolicy existing_policy = ExistingCampaignPolicy::ReuseStrict;
+size_t NUM_BITFLIPS = 500;
+// p-value below which the bit counts flag a ciphertext
+double INTEGRITY_ALPHA = 1e-3;
+
+static int64_t elapsedNs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Detector benchmark: every flip is injected once and the same faulty
+// ciphertext is judged by the SKA check at each --thresholdsSKA value
+// (one Decrypt per threshold) and by the integrity checks. Ground truth is
+// whether the decrypted result still passes AcceptCKKSResult. Overheads are
+// what each detector adds: an SKA Decrypt minus a plain Decrypt of the same
+// ciphertext, and the residue scan for the integrity checks.
+int main(int argc, char* argv[]) {
+    CampaignArgs args = parse_arguments(argc, argv);
+    args.isExhaustive= false;
+    args.existing_policy = existing_policy;
+    const std::vector<double> thresholds = parse_double_list(args.thresholdsSKA);
+
+    // The thresholds and the attack mode are key columns of this library
+    // (campaign_registry.cpp), so each combination gets its own campaign id
+    // and its own detectors_<id>.csv
+    args.library = "openfhe-detectors";
+    if (args.verbose) {
+        args.print();
+    }
+
+    BackendContext* bctx = setup_campaign(args);
+    auto& ctx = static_cast<OpenFHEContext&>(*bctx);
+    IterationResult goldenCKKS_output = run_iteration(bctx, args);
+
+    const auto& goldenOutput = get_reference_output(bctx);
+    CKKSAccuracyMetrics baseline_metrics = EvaluateCKKSAccuracy(goldenOutput, goldenCKKS_output.values);
+
+    if(AcceptCKKSResult(baseline_metrics)){
+        try{
+            CampaignRegistry registry(args);
+            uint32_t campaign_id = registry.campaign_id;
+            std::cout << "\n=== Starting Detector Benchmark " << campaign_id << " ===" << std::endl;
+
+            DetectorBench bench;
+            std::vector<size_t> skaIdx;
+            for (double t : thresholds) {
+                std::ostringstream name;
+                name << "ska_" << t;
+                skaIdx.push_back(bench.add(name.str()));
+            }
+            const size_t rangeIdx = bench.add("integrity_range");
+            const size_t chi2Idx = bench.add("integrity_chi2");
+
+            auto start_time = std::chrono::high_resolution_clock::now();
+            uint32_t N = 1 << args.logN;
+            uint64_t total = 0, corruptedCount = 0;
+            std::vector<double> norms;
+            std::vector<bool> skaFired(thresholds.size());
+            std::vector<int64_t> skaNs(thresholds.size());
+
+            std::vector<uint32_t> bits_to_flip = bitsToFlipGenerator(args);
+            for (uint32_t bit : bits_to_flip) {
+                std::cout << bit << std::endl;
+                for (size_t i = 0; i < NUM_BITFLIPS; i++) {
+                    uint32_t limb = random_int(0, args.mult_depth);
+                    uint32_t coeff = random_int(0, N-1);
+                    IterationArgs iterArgs(limb, coeff, bit);
+                    Ciphertext<DCRTPoly> c = faulty_cipher(bctx, args, iterArgs);
+
+                    // The decrypted values do not depend on the detector,
+                    // only the detection flag does. The plain Decrypt gives
+                    // them and the time the SKA overheads are taken from.
+                    disable_ska_detector();
+                    auto t0 = std::chrono::steady_clock::now();
+                    Plaintext plain;
+                    ctx.cc->Decrypt(ctx.keys.secretKey, c, &plain);
+                    const int64_t plainNs = elapsedNs(t0);
+                    plain->SetLength(1 << args.logSlots);
+                    std::vector<double> values = plain->GetRealPackedValue();
+
+                    for (size_t k = 0; k < thresholds.size(); ++k) {
+                        set_ska_detector(args, thresholds[k]);
+                        t0 = std::chrono::steady_clock::now();
+                        Plaintext pt;
+                        ctx.cc->Decrypt(ctx.keys.secretKey, c, &pt);
+                        skaFired[k] = SDCConfigHelper::WasSDCDetected(pt);
+                        skaNs[k] = elapsedNs(t0) - plainNs;
+                    }
+
+                    t0 = std::chrono::steady_clock::now();
+                    IntegrityStats stats = cipher_integrity(c);
+                    int64_t integrityNs = elapsedNs(t0);
+
+                    CKKSAccuracyMetrics m = EvaluateCKKSAccuracy(goldenCKKS_output.values, values);
+                    bool corrupted = !AcceptCKKSResult(m);
+                    for (size_t k = 0; k < thresholds.size(); ++k)
+                        bench.record(skaIdx[k], skaFired[k], corrupted, skaNs[k]);
+                    bench.record(rangeIdx, stats.outOfRange > 0, corrupted, integrityNs);
+                    bench.record(chi2Idx, integrity_suspect(stats, INTEGRITY_ALPHA), corrupted, integrityNs);
+
+                    total++;
+                    corruptedCount += corrupted;
+                    norms.push_back(m.l2_rel_error);
+                }
+            }
+            set_ska_detector(args, args.openfhe_threshold_bits.value_or(5.0));
+
+            bench.print();
+            std::filesystem::create_directories(args.results_dir + "/data");
+            bench.writeCsv(args.results_dir + "/data/detectors_" + std::to_string(campaign_id) + ".csv",
+                           campaign_id);
+
+            std::sort(norms.begin(), norms.end());
+            double l2_P95 = percentile(norms, 0.95);
+            double l2_P99 = percentile(norms, 0.99);
+            auto end_time = std::chrono::high_resolution_clock::now();
+            auto minutes = std::chrono::duration_cast<std::chrono::minutes>(end_time - start_time);
+            uint64_t mins = minutes.count();
+
+            registry.register_end({campaign_id, total, corruptedCount, mins, l2_P95, l2_P99, timestamp_now()});
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << e.what() << '\n';
+            return 0;
+        }
+    } else {
+        printBaselineComparison(
+            args,
+            goldenOutput,
+            goldenCKKS_output.values,
+            baseline_metrics
+        );
+        return 1;
+    }
+    return 0;
+}
@@ -8,62 +8,14 @@
 
 size_t NUM_BITFLIPS = 500;
 
-bool coeffIntegrityCheck(Poly& c, size_t coeff, const Poly::Integer mod){
-    auto c_coeff = c.GetValues()[coeff];
-    bool bigger = c_coeff > mod;
-    return bigger;
-}
-
-double bitUniform(Poly& c, const Poly::Integer mod, size_t N) {
-    size_t logMod = mod.GetMSB();
-    auto c_coeffs = c.GetValues();
-    double worst = 0.0;
-    for (size_t bit = 0; bit < logMod; bit++) {
-        size_t ones = 0;
-        for (size_t coeff = 0; coeff < N; coeff++) {
-            uschar bitval = c_coeffs[coeff].GetBitAtIndex(bit);
-            if (bitval)
-                ones++;
-        }
-        double ratio = ones / (double)N;
-        double deviation = std::abs(ratio - 0.5);
-
-        worst = std::max(worst, deviation);
-    }
-    return worst;
-}
-
-double cipherBitUniform(Ciphertext<DCRTPoly>& cx){
-    DCRTPoly c0 = cx->GetElements()[0];
-    DCRTPoly c1 = cx->GetElements()[1];
-    size_t N = c0.GetRingDimension();
-    c0.SetFormat(Format::COEFFICIENT);
-    c1.SetFormat(Format::COEFFICIENT);
-    Poly c0_p = c0.CRTInterpolate();
-    Poly c1_p = c1.CRTInterpolate();
-    const Poly::Integer mod  = c0_p.GetModulus();
-    double c0_worst = bitUniform(c0_p, mod, N);
-    double c1_worst = bitUniform(c1_p, mod, N);
-    std::cout << c0_worst << ", " << c1_worst << std::endl;
-    return std::max(c0_worst, c1_worst);
-}
-
-bool integrityChequer(Ciphertext<DCRTPoly>& cx){
-    bool corrupt = false;
-    DCRTPoly c0 = cx->GetElements()[0];
-    DCRTPoly c1 = cx->GetElements()[1];
-    size_t N = c0.GetRingDimension();
-    c0.SetFormat(Format::COEFFICIENT);
-    c1.SetFormat(Format::COEFFICIENT);
-    Poly c0_p = c0.CRTInterpolate();
-    Poly c1_p = c1.CRTInterpolate();
-    const Poly::Integer mod  = c0_p.GetModulus();
-    size_t coeff = 0;
-    while(corrupt==false && coeff<N){
-        corrupt = coeffIntegrityCheck(c0_p, coeff, mod) && coeffIntegrityCheck(c1_p, coeff, mod);
-        coeff++;
-    }
-    return corrupt;
+// p-value below which the bit counts flag a ciphertext
+double INTEGRITY_ALPHA = 1e-3;
+
+void printIntegrity(const IntegrityStats& s){
+    std::cout << "outOfRange: " << s.outOfRange
+              << ", chi2: " << s.chi2 << "/" << s.dof
+              << ", p: " << s.pValue()
+              << ", worst: " << s.worstDeviation << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -80,7 +32,7 @@ int main(int argc, char* argv[]) {
     const auto& goldenOutput = get_reference_output(ctx);
     CKKSAccuracyMetrics baseline_metrics = EvaluateCKKSAccuracy(goldenOutput, goldenCKKS_output.values);
     IterationChequer chequerRes = gen_cipher(ctx, args);
-    cipherBitUniform(chequerRes.cipher);
+    printIntegrity(cipher_integrity(chequerRes.cipher));
     if(AcceptCKKSResult(baseline_metrics)){
         auto start_time = std::chrono::high_resolution_clock::now();
 
@@ -99,10 +51,10 @@ int main(int argc, char* argv[]) {
                 uint32_t coeff = random_int(0, N-1);
                 IterationArgs iterArgs(limb, coeff, bit);
                 IterationChequer chequerRes = gen_cipher(ctx, args, iterArgs);
-                cipherBitUniform(chequerRes.cipher);
-     //           bool chequer =  integrityChequer(chequerRes.cipher);
-       //         std::cout << "Integrity chequer: " <<  chequer  << ", Openfhe detection: " << chequerRes.detected << std::endl;
-                std::cout << "Openfhe detection: " << chequerRes.detected << std::endl;
+                IntegrityStats stats = cipher_integrity(chequerRes.cipher);
+                printIntegrity(stats);
+                std::cout << "Integrity chequer: " << integrity_suspect(stats, INTEGRITY_ALPHA)
+                          << ", Openfhe detection: " << chequerRes.detected << std::endl;
             }
         }
 
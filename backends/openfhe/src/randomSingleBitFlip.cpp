@@ -33,7 +33,7 @@ int main(int argc, char* argv[]) {
 
             std::cout << "\n=== Starting Campaign " << campaign_id << " ===" << std::endl;
 
-            CampaignLogger logger(campaign_id, args.results_dir + "/data", 10000);
+            CampaignLogger logger(campaign_id, args.results_dir + "/data", 10000, RecordOptions::from(args));
             std::cout << "Campaign " << campaign_id << " registered" << std::endl;
 
             auto start_time = std::chrono::high_resolution_clock::now();
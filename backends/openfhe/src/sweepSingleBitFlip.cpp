@@ -0,0 +1,77 @@
+#include "openfhe.h"
+#include "campaign_helper.h"
+#include "campaign_logger.h"
+#include "campaign_exhaustive.h"
+#include "campaign_forkserver.h"
+#include "campaign_sweep.h"
+#include "backend_interface.h"
+#include "utils_ckks.h"
+
+// Runs the exhaustiveSingleBitFlip rows of a run_campaign.py config in one
+// process: rows that only differ in stage/op_step/op_depth share the keys,
+// the golden output and the cached ciphertexts of one setup_campaign. Each
+// row runs the same loop as exhaustiveSingleBitFlip (run_exhaustive_campaign).
+
+ExistingCampaignPolicy existing_policy = ExistingCampaignPolicy::ReuseStrict;
+
+static void apply_overrides(CampaignArgs& args)
+{
+    args.library = "openfhe";
+    args.isExhaustive = true;
+    args.existing_policy = existing_policy;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <config.csv>\n";
+        return 1;
+    }
+
+    auto groups = load_sweep_groups(argv[1], "openfhe", "exhaustiveSingleBitFlip");
+    std::cout << "Sweep: " << groups.size() << " groups" << std::endl;
+
+    int failed = 0;
+    for (const auto& group : groups) {
+        CampaignArgs groupArgs = sweep_row_args(group.rows.front(), argv[0]);
+        apply_overrides(groupArgs);
+        if (groupArgs.verbose) {
+            groupArgs.print();
+        }
+
+        // Forked workers only get the main thread: no OpenMP pool before fork
+        if (groupArgs.workers > 0)
+            prepare_fork_server();
+
+        BackendContext* ctx = setup_campaign(groupArgs);
+
+        // The golden run has no flip, so it is the same for every row.
+        IterationResult goldenCKKS_output = run_iteration(ctx, groupArgs);
+        const auto& goldenOutput = get_reference_output(ctx);
+        CKKSAccuracyMetrics baseline_metrics = EvaluateCKKSAccuracy(goldenOutput, goldenCKKS_output.values);
+
+        if (!AcceptCKKSResult(baseline_metrics)) {
+            printBaselineComparison(groupArgs, goldenOutput, goldenCKKS_output.values, baseline_metrics);
+            failed += group.rows.size();
+            destroy_campaign(ctx);
+            continue;
+        }
+
+        for (const auto& row : group.rows) {
+            CampaignArgs args = sweep_row_args(row, argv[0]);
+            apply_overrides(args);
+            std::cout << "\n=== Run " << row.run_id << std::endl;
+            try {
+                ExhaustiveOptions opts;
+                opts.sharedContextThreads = true;
+                run_exhaustive_campaign(args, [&](const IterationArgs& iterArgs) {
+                    return evaluate_flip(ctx, args, goldenCKKS_output, iterArgs);
+                }, opts);
+            } catch (const std::runtime_error& e) {
+                std::cerr << row.run_id << ": " << e.what() << '\n';
+            }
+        }
+        destroy_campaign(ctx);
+    }
+
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+#include "utils_nn.h"
+#include "campaign_helper.h"
+#include "nn_profiler.h"
+
+#include <random>
+
+// reduceSum over one block of 2^logSlots slots with radix 2, 4 and 8
+// (radixLog 1..3), timed through NNProfiler on the same context parameters
+// as the NN campaigns. Keys are generated before the timed runs. Prints one
+// row per radix: hoisted decompositions, key switches and keys per call,
+// mean microseconds per call and the error of slot 0 against the plain sum.
+// HEEnv defaults to radixLog 1; switch it only where this shows a clear win.
+const size_t REPS = 20;
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    CampaignArgs args = parse_arguments(argc, argv);
+    if (args.verbose) {
+        args.print();
+    }
+    const size_t logSlots = args.logSlots;
+    if (logSlots + 1 > args.logN) {
+        cerr << "reduceSumBench: logSlots debe ser < logN\n";
+        return 1;
+    }
+
+    std::mt19937 gen(args.seed_input);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    vector<double> vals(size_t(1) << logSlots);
+    double plainSum = 0.0;
+    for (auto& v : vals) {
+        v = dist(gen);
+        plainSum += v;
+    }
+
+    cout << "radixLog,decompositions,key_switches,keys,mean_us,slot0_error\n";
+    for (uint32_t radixLog = 1; radixLog <= 3; ++radixLog) {
+        HEEnv he(args.logN, args.mult_depth, args.logDelta, args.logQ, {}, args.keySeed, radixLog);
+        const auto steps = reduceSumRotations(logSlots, radixLog);
+        he.requireRotations(steps);
+        auto c = he.cc->Encrypt(he.keys.publicKey, he.cc->MakeCKKSPackedPlaintext(vals));
+
+        // Warm-up outside the profile
+        auto warm = c;
+        reduceSum(he, warm, logSlots);
+
+        NNProfiler profiler;
+        he.profiler = &profiler;
+        Ciphertext<DCRTPoly> out;
+        for (size_t r = 0; r < REPS; ++r) {
+            out = c;
+            {
+                ProfileScope scope(&profiler, "reduceSum");
+                reduceSum(he, out, logSlots);
+            }
+            profiler.endRun();
+        }
+        he.profiler = nullptr;
+
+        Plaintext dec;
+        he.cc->Decrypt(he.keys.secretKey, out, &dec);
+        double slot0 = dec->GetCKKSPackedValue()[0].real();
+
+        const ProfileData& total = profiler.aggregate();
+        auto op = [&](const char* name) {
+            auto it = total.ops.find(name);
+            return it == total.ops.end() ? 0.0 : static_cast<double>(it->second) / REPS;
+        };
+        const ProfileSection& s = total.sections.at("reduceSum");
+        cout << radixLog << ',' << op("hoisted_precompute") << ',' << op("key_switch") << ','
+             << steps.size() << ',' << static_cast<double>(s.ns) / 1e3 / s.calls << ','
+             << std::fabs(slot0 - plainSum) << endl;
+    }
+    return 0;
+}
@@ -33,42 +33,62 @@ EncodedWeights encodeWeights(
     const vector<double>& b1,
     const vector<vector<double>>& W2,
     const vector<double>& b2,
-    size_t slots
+    size_t slots,
+    size_t blockSize
 ){
     EncodedWeights ew;
+    size_t block = blockSize > 0 ? blockSize : slots;
 
     vector<double> buffer(slots);
 
     // W1
     for (size_t j = 0; j < W1.size(); ++j) {
         fill(buffer.begin(), buffer.end(), 0.0);
-        for (size_t i = 0; i < W1[j].size(); ++i)
-            buffer[i] = W1[j][i];
+        // One copy of the row per image block
+        for (size_t b = 0; b < slots; b += block)
+            for (size_t i = 0; i < W1[j].size(); ++i)
+                buffer[b + i] = W1[j][i];
 
         ew.W1.push_back(he.cc->MakeCKKSPackedPlaintext(buffer));
     }
 
-    // b1
-    for (auto v : b1) {
-        fill(buffer.begin(), buffer.end(), v);
-        ew.b1.push_back(he.cc->MakeCKKSPackedPlaintext(buffer));
-    }
+    // b1, W2 and b2 fill every slot with one value: kept as scalars for
+    // EvalAdd/EvalMult(ct, double) instead of encoded plaintexts
+    ew.b1 = b1;
+    ew.W2 = W2;
+    ew.b2 = b2;
 
-    // W2
-    ew.W2.resize(W2.size());
-    for (size_t o = 0; o < W2.size(); ++o) {
-        ew.W2[o].resize(W2[o].size());
-        for (size_t h = 0; h < W2[o].size(); ++h) {
-            fill(buffer.begin(), buffer.end(), W2[o][h]);
-            ew.W2[o][h] = he.cc->MakeCKKSPackedPlaintext(buffer);
-        }
-    }
+    return ew;
+}
 
-    // b2
-    for (auto v : b2) {
-        fill(buffer.begin(), buffer.end(), v);
-        ew.b2.push_back(he.cc->MakeCKKSPackedPlaintext(buffer));
-    }
+// block repeated over the whole batch, so a rotation of the ciphertext is a
+// cyclic rotation of every block
+static Plaintext makeRepeatedPlaintext(HEEnv& he, const vector<double>& block)
+{
+    size_t batchSize = he.cc->GetEncodingParams()->GetBatchSize();
+    vector<double> buffer(batchSize);
+    for (size_t i = 0; i < batchSize; ++i)
+        buffer[i] = block[i % block.size()];
+    return he.cc->MakeCKKSPackedPlaintext(buffer);
+}
+
+EncodedWeights encodeWeightsPacked(
+    HEEnv& he,
+    const vector<vector<double>>& W1,
+    const vector<double>& b1,
+    const vector<vector<double>>& W2,
+    const vector<double>& b2,
+    size_t slots
+){
+    EncodedWeights ew;
+    ew.layout = packedLayout(slots, W1.size(), W2.size());
+
+    for (auto& d : packedDiagonals(ew.layout, W1))
+        ew.W1diag.push_back(makeRepeatedPlaintext(he, d));
+
+    ew.b1Packed = makeRepeatedPlaintext(he, packedRepeat(ew.layout, b1));
+    ew.W2Packed = makeRepeatedPlaintext(he, packedLayer2(ew.layout, W2));
+    ew.b2Packed = makeRepeatedPlaintext(he, packedBias2(ew.layout, b2));
 
     return ew;
 }
@@ -93,6 +113,11 @@ Ciphertext<DCRTPoly> chebyTanh3(
     HEEnv& he,
     Ciphertext<DCRTPoly>& x
 ) {
+    ProfileScope scope(he.profiler, "layer1.chebyTanh3");
+    // 2 ciphertext products (relinearized), 2 constant products
+    profileCount(he.profiler, "mult_ct", 2);
+    profileCount(he.profiler, "key_switch", 2);
+    profileCount(he.profiler, "mult_const", 2);
     auto x2 = he.cc->EvalMult(x, x);
     auto x3 = he.cc->EvalMult(x2, x);
 
@@ -104,14 +129,46 @@ Ciphertext<DCRTPoly> chebyTanh3(
 
 
 
+std::vector<int> reduceSumRotations(uint32_t logBlock, uint32_t radixLog)
+{
+    if (radixLog == 0)
+        throw std::invalid_argument("reduceSumRotations: radixLog debe ser > 0");
+
+    std::vector<int> idx;
+    for (uint32_t done = 0; done < logBlock; done += radixLog) {
+        uint32_t t = std::min(radixLog, logBlock - done);
+        int stride = 1 << done;
+        for (int j = 1; j < (1 << t); ++j)
+            idx.push_back(j * stride);
+    }
+    return idx;
+}
+
+// Radix-2^radixLog tree: every level decomposes ct once
+// (EvalFastRotationPrecompute) and reuses it for all its rotations, so a
+// block of 2^logSlots needs ceil(logSlots/radixLog) decompositions instead
+// of logSlots.
 Ciphertext<DCRTPoly> reduceSum(
     HEEnv& he,
     Ciphertext<DCRTPoly>& ct,
     size_t logSlots
 ) {
-    for (size_t i = 0; i < logSlots; ++i) {
-        auto rot = he.cc->EvalRotate(ct, 1 << i);
-        ct = he.cc->EvalAdd(ct, rot);
+    const uint32_t M = he.cc->GetCyclotomicOrder();
+
+    for (size_t done = 0; done < logSlots; done += he.radixLog) {
+        size_t t = std::min<size_t>(he.radixLog, logSlots - done);
+        int stride = 1 << done;
+
+        auto precomp = he.cc->EvalFastRotationPrecompute(ct);
+        profileCount(he.profiler, "hoisted_precompute");
+        profileCount(he.profiler, "rotation", (1 << t) - 1);
+        profileCount(he.profiler, "key_switch", (1 << t) - 1);
+        auto acc = ct;
+        for (int j = 1; j < (1 << t); ++j) {
+            auto rot = he.cc->EvalFastRotation(ct, j * stride, M, precomp);
+            acc = he.cc->EvalAdd(acc, rot);
+        }
+        ct = acc;
     }
     return ct;
 }
@@ -120,65 +177,152 @@ vector<Ciphertext<DCRTPoly>> forward(
     HEEnv& he,
     Ciphertext<DCRTPoly> c,
     EncodedWeights& ew,
-    size_t logSlots
+    size_t logSlots,
+    size_t threads
 )
 {
+    ProfileScope forwardScope(he.profiler, "forward");
+    // Before the threaded neurons: the key store is not thread-safe
+    he.requireRotations(reduceSumRotations(logSlots, he.radixLog));
     size_t HIDDEN = ew.W1.size();
     size_t OUTPUT = ew.W2.size();
 
     vector<Ciphertext<DCRTPoly>> layer1(HIDDEN);
 
-    // ===== Layer 1 =====
-    for (size_t j = 0; j < HIDDEN; ++j) {
+    // ===== Layer 1: independent neurons =====
+    parallel_for(HIDDEN, threads, [&](size_t j, size_t) {
+        ProfileScope neuronScope(he.profiler, "layer1.neuron", j);
+
+        Ciphertext<DCRTPoly> s;
+        {
+        ProfileScope scope(he.profiler, "layer1.multByPoly");
+        profileCount(he.profiler, "mult_plain");
+        profileCount(he.profiler, "rescale");
 
         // multByPoly
-        auto s = he.cc->EvalMult(c, ew.W1[j]);
+        s = he.cc->EvalMult(c, ew.W1[j]);
 
         // IMPORTANTE: rescale manual
         he.cc->RescaleInPlace(s);
+        }
 
         // reduceSum SIMD
-        for (size_t i = 0; i < logSlots; ++i) {
-            auto rot = he.cc->EvalRotate(s, 1 << i);
-            s = he.cc->EvalAdd(s, rot);
+        {
+        ProfileScope scope(he.profiler, "layer1.reduceSum");
+        s = reduceSum(he, s, logSlots);
         }
 
         // bias
         s = he.cc->EvalAdd(s, ew.b1[j]);
 
         // Chebyshev
-        s = chebyTanh3(he, s);
-
-        layer1[j] = s;
-    }
+        layer1[j] = chebyTanh3(he, s);
+    });
 
     // ===== Layer 2 =====
+    // One output at a time: products in parallel, then a fixed pairwise
+    // tree so the logits do not depend on the thread count
     vector<Ciphertext<DCRTPoly>> out(OUTPUT);
+    vector<vector<Ciphertext<DCRTPoly>>> terms(1, vector<Ciphertext<DCRTPoly>>(HIDDEN));
 
     for (size_t o = 0; o < OUTPUT; ++o) {
 
-        auto acc = he.cc->EvalMult(layer1[0], ew.W2[o][0]);
-        he.cc->RescaleInPlace(acc);
+        parallel_for(HIDDEN, threads, [&](size_t h, size_t) {
+            ProfileScope scope(he.profiler, "layer2.multByConst");
+            profileCount(he.profiler, "mult_const");
+            profileCount(he.profiler, "rescale");
+            terms[0][h] = he.cc->EvalMult(layer1[h], ew.W2[o][h]);
+            he.cc->RescaleInPlace(terms[0][h]);
+        });
+        {
+        ProfileScope scope(he.profiler, "layer2.accumulate");
+        parallel_tree_reduce(terms, threads,
+            [&](Ciphertext<DCRTPoly>& a, Ciphertext<DCRTPoly>& b) {
+                he.cc->EvalAddInPlace(a, b);
+            });
+        }
 
-        for (size_t h = 1; h < HIDDEN; ++h) {
+        out[o] = he.cc->EvalAdd(terms[0][0], ew.b2[o]);
+    }
 
-            auto term = he.cc->EvalMult(layer1[h], ew.W2[o][h]);
-            he.cc->RescaleInPlace(term);
+    return out;
+}
 
-            acc = he.cc->EvalAdd(acc, term);
-        }
+vector<Ciphertext<DCRTPoly>> forwardPacked(
+    HEEnv& he,
+    Ciphertext<DCRTPoly> c,
+    EncodedWeights& ew
+)
+{
+    ProfileScope forwardScope(he.profiler, "forward");
+    const PackedMLPLayout& L = ew.layout;
+    const uint32_t M = he.cc->GetCyclotomicOrder();
+
+    // Baby, giant and stride steps, then the radix-2^radixLog block sums,
+    // in one call so the budget cannot evict the first ones
+    std::vector<int> steps = packedRotations(L);
+    for (int s : reduceSumRotations(L.logM, he.radixLog))
+        if (std::find(steps.begin(), steps.end(), s) == steps.end())
+            steps.push_back(s);
+    he.requireRotations(steps);
+
+    std::optional<ProfileScope> layer1Scope;
+    layer1Scope.emplace(he.profiler, "packed.layer1");
+    profileCount(he.profiler, "mult_plain", L.n1*L.n2);
+    profileCount(he.profiler, "hoisted_precompute");
+    profileCount(he.profiler, "rotation", (L.n1-1) + (L.n2-1));
+    profileCount(he.profiler, "key_switch", (L.n1-1) + (L.n2-1));
+    profileCount(he.profiler, "rescale");
+
+    // ===== Layer 1: BSGS over the diagonals =====
+    // Baby steps share one hoisted decomposition of c
+    auto precomp = he.cc->EvalFastRotationPrecompute(c);
+    vector<Ciphertext<DCRTPoly>> babies(L.n1);
+    babies[0] = c;
+    for (size_t b = 1; b < L.n1; ++b)
+        babies[b] = he.cc->EvalFastRotation(c, b, M, precomp);
+
+    Ciphertext<DCRTPoly> z;
+    for (size_t g = 0; g < L.n2; ++g) {
+        auto inner = he.cc->EvalMult(babies[0], ew.W1diag[g * L.n1]);
+        for (size_t b = 1; b < L.n1; ++b)
+            inner = he.cc->EvalAdd(inner, he.cc->EvalMult(babies[b], ew.W1diag[g * L.n1 + b]));
+
+        z = (g == 0) ? inner : he.cc->EvalAdd(z, he.cc->EvalRotate(inner, g * L.n1));
+    }
+    he.cc->RescaleInPlace(z);
+    layer1Scope.reset();
+
+    // Fold the n/m partial sums: every slot i ends up with h[i mod m]
+    {
+    ProfileScope scope(he.profiler, "packed.strideSum");
+    profileCount(he.profiler, "rotation", L.strideLevels);
+    profileCount(he.profiler, "key_switch", L.strideLevels);
+    for (size_t s = L.m; s < L.n; s <<= 1)
+        z = he.cc->EvalAdd(z, he.cc->EvalRotate(z, s));
+    }
 
-        acc = he.cc->EvalAdd(acc, ew.b2[o]);
+    z = he.cc->EvalAdd(z, ew.b1Packed);
+    auto a = chebyTanh3(he, z);
 
-        out[o] = acc;
-    }
+    // ===== Layer 2: W2[o][j]*a[j] at slot o*m+j, then sum each block of m =====
+    ProfileScope layer2Scope(he.profiler, "packed.layer2");
+    profileCount(he.profiler, "mult_plain");
+    profileCount(he.profiler, "rescale");
+    auto acc = he.cc->EvalMult(a, ew.W2Packed);
+    he.cc->RescaleInPlace(acc);
+    acc = reduceSum(he, acc, L.logM);
+    acc = he.cc->EvalAdd(acc, ew.b2Packed);
 
-    return out;
+    return {acc};
 }
+
 vector<double> decryptLogits(
     HEEnv& he,
     vector<Ciphertext<DCRTPoly>>& outs
 ){
+    // Decrypt and decode (OpenFHE does both in Decrypt)
+    ProfileScope scope(he.profiler, "client.decrypt");
     vector<double> res(outs.size());
 
     size_t batchSize =
@@ -200,6 +344,58 @@ vector<double> decryptLogits(
     return res;
 }
 
+vector<double> decryptLogitsPacked(
+    HEEnv& he,
+    Ciphertext<DCRTPoly>& out,
+    size_t stride,
+    size_t outputs
+){
+    ProfileScope scope(he.profiler, "client.decrypt");
+    size_t batchSize =
+        he.cc->GetEncodingParams()->GetBatchSize();
+
+    Plaintext dec;
+    he.cc->Decrypt(he.keys.secretKey, out, &dec);
+    dec->SetLength(batchSize);
+
+    auto vals = dec->GetCKKSPackedValue();
+
+    vector<double> res(outputs);
+    for (size_t o = 0; o < outputs; ++o)
+        res[o] = vals[o * stride].real();
+    return res;
+}
+
+vector<vector<double>> decryptLogitsBatch(
+    HEEnv& he,
+    vector<Ciphertext<DCRTPoly>>& outs,
+    size_t blockSize,
+    size_t batch
+){
+    ProfileScope scope(he.profiler, "client.decrypt");
+    vector<vector<double>> res(batch, vector<double>(outs.size()));
+
+    size_t batchSize =
+        he.cc->GetEncodingParams()->GetBatchSize();
+
+    for(size_t i = 0; i < outs.size(); ++i){
+
+        Plaintext dec;
+        he.cc->Decrypt(he.keys.secretKey, outs[i], &dec);
+
+        dec->SetLength(batchSize);
+
+        auto vals = dec->GetCKKSPackedValue();
+
+        // Image b's logit sits at slot b*blockSize
+        for(size_t b = 0; b < batch; ++b)
+            res[b][i] = vals[b * blockSize].real();
+    }
+
+    return res;
+}
+
+
 bool loadMnistNormRowByIndex(const std::string &csvPath, size_t rowIndex,
                          size_t &outLabel, std::vector<double> &pixelsOut)
 {
@@ -316,17 +512,28 @@ std::vector<double> loadCSVVector(const std::string& path, size_t size) {
 
     return data;
 }
-IterationResult run_iteration_NN(
-    HEEnv& he,
-    EncodedWeights& encoded,
-    const vector<double>& vals,
-    CampaignArgs& args,
-    size_t targetValue,
-    std::optional<IterationArgs> iterArgs
-) {
-    size_t verbose = args.verbose;
+// images[b] in slot block b, encoded and encrypted; the encode and
+// encrypt_c0/encrypt_c1 faults are applied here
+static Ciphertext<DCRTPoly> encryptImages(HEEnv& he,
+        const vector<vector<double>>& images, CampaignArgs& args,
+        std::optional<IterationArgs> iterArgs)
+{
+    ProfileScope scope(he.profiler, "client.encrypt");
+    size_t blockSize = 1 << args.logSlots;
+    size_t batch = images.size();
 
     // ===== Encoding =====
+    vector<double> vals(blockSize * (batch - 1) + images[batch - 1].size(), 0.0);
+    for (size_t b = 0; b < batch; ++b)
+        std::copy(images[b].begin(), images[b].end(), vals.begin() + b * blockSize);
+    if (args.nnPacked) {
+        // The packed layout rotates inside the block, so repeat it
+        // over the whole batch like the packed weights
+        size_t batchSize = he.cc->GetEncodingParams()->GetBatchSize();
+        vals.resize(batchSize, 0.0);
+        for (size_t i = blockSize; i < batchSize; ++i)
+            vals[i] = vals[i % blockSize];
+    }
     Plaintext ptxt = he.cc->MakeCKKSPackedPlaintext(vals);
 
     if (iterArgs && args.stage == "encode") {
@@ -352,41 +559,58 @@ IterationResult run_iteration_NN(
                     iterArgs->bit);
         }
     }
+    return c;
+}
 
+// Logits of every image, decrypted from the forward outputs
+static vector<vector<double>> decryptAll(HEEnv& he, EncodedWeights& encoded,
+        vector<Ciphertext<DCRTPoly>>& outputs, CampaignArgs& args, size_t batch)
+{
+    return args.nnPacked
+        ? vector<vector<double>>{decryptLogitsPacked(he, outputs[0], encoded.layout.m, encoded.layout.out)}
+        : decryptLogitsBatch(he, outputs, 1 << args.logSlots, batch);
+}
 
+static bool isDecryptStage(const CampaignArgs& args)
+{
+    return args.stage == "decrypt_c0" || args.stage == "decrypt_c1";
+}
 
-    if (verbose)
-        cout << "Running encrypted inference..." << endl;
+bool cleanCacheApplies(const CampaignArgs& args)
+{
+    return isDecryptStage(args);
+}
 
-    auto outputs = forward(he, c, encoded, args.logSlots);
+void buildCleanCache(HEEnv& he, EncodedWeights& encoded,
+        const vector<vector<double>>& images, CampaignArgs& args,
+        NNCleanCache& clean)
+{
+    auto c = encryptImages(he, images, args, std::nullopt);
+    clean.outputs = args.nnPacked ? forwardPacked(he, c, encoded)
+                                  : forward(he, c, encoded, args.logSlots,
+                                            std::max<uint32_t>(args.threads, 1));
+    clean.logits = decryptAll(he, encoded, clean.outputs, args, images.size());
+    clean.valid = true;
+}
 
-    if (verbose)
-        cout << "Decrypting..." << endl;
-    if (iterArgs) {
-        if (args.stage == "decrypt_c0") {
-            bitFlip(outputs[targetValue], args.withNTT, 0,
-                    iterArgs->limb,
-                    iterArgs->coeff,
-                    iterArgs->bit);
-        } else if (args.stage == "decrypt_c1") {
-            bitFlip(outputs[targetValue], args.withNTT, 1,
-                    iterArgs->limb,
-                    iterArgs->coeff,
-                    iterArgs->bit);
-        }
-    }
-    auto logits = decryptLogits(he, outputs);
+// preds[b] = argmax of logits[b]; detected refers to image 0
+static IterationResult predictFromLogits(const vector<vector<double>>& logits,
+        size_t targetValue, vector<size_t>& preds, size_t verbose)
+{
+    size_t batch = logits.size();
 
     // ===== Prediction =====
-    size_t pred = 0;
-    double best = logits[0];
-
-    for (size_t i = 1; i < logits.size(); ++i) {
-        if (logits[i] > best) {
-            best = logits[i];
-            pred = i;
+    preds.assign(batch, 0);
+    for (size_t b = 0; b < batch; ++b) {
+        double best = logits[b][0];
+        for (size_t i = 1; i < logits[b].size(); ++i) {
+            if (logits[b][i] > best) {
+                best = logits[b][i];
+                preds[b] = i;
+            }
         }
     }
+    size_t pred = preds[0];
 
     IterationResult res;
     res.detected = (pred == targetValue);
@@ -404,4 +628,83 @@ IterationResult run_iteration_NN(
     return res;
 }
 
+IterationResult run_iteration_NN_batch(
+    HEEnv& he,
+    EncodedWeights& encoded,
+    const vector<vector<double>>& images,
+    CampaignArgs& args,
+    size_t targetValue,
+    vector<size_t>& preds,
+    std::optional<IterationArgs> iterArgs,
+    const NNCleanCache* clean
+) {
+    size_t verbose = args.verbose;
+    size_t batch = images.size();
+
+    // Clean run: the cache already has the logits
+    if (clean && clean->valid && !iterArgs)
+        return predictFromLogits(clean->logits, targetValue, preds, verbose);
+
+    // The packed forward returns every logit in one ciphertext
+    size_t faulty = args.nnPacked ? 0 : targetValue;
+
+    vector<Ciphertext<DCRTPoly>> outputs;
+    const bool late = clean && clean->valid && iterArgs && isDecryptStage(args);
+    if (late) {
+        // Only outputs[faulty] changes: decrypt that copy, keep the
+        // clean logits of the others
+        outputs = {clean->outputs[faulty]->Clone()};
+        faulty = 0;
+    } else {
+        auto c = encryptImages(he, images, args, iterArgs);
+
+        if (verbose)
+            cout << "Running encrypted inference..." << endl;
 
+        // reduceSum works on logSlots (one block), so every block sums
+        // into its own first slot.
+        outputs = args.nnPacked ? forwardPacked(he, c, encoded)
+                                : forward(he, c, encoded, args.logSlots,
+                                          std::max<uint32_t>(args.threads, 1));
+    }
+
+    if (verbose)
+        cout << "Decrypting..." << endl;
+    if (iterArgs) {
+        if (args.stage == "decrypt_c0") {
+            bitFlip(outputs[faulty], args.withNTT, 0,
+                    iterArgs->limb,
+                    iterArgs->coeff,
+                    iterArgs->bit);
+        } else if (args.stage == "decrypt_c1") {
+            bitFlip(outputs[faulty], args.withNTT, 1,
+                    iterArgs->limb,
+                    iterArgs->coeff,
+                    iterArgs->bit);
+        }
+    }
+
+    if (late && !args.nnPacked) {
+        auto logits = clean->logits;
+        auto column = decryptLogitsBatch(he, outputs, 1 << args.logSlots, batch);
+        for (size_t b = 0; b < batch; ++b)
+            logits[b][targetValue] = column[b][0];
+        return predictFromLogits(logits, targetValue, preds, verbose);
+    }
+    auto logits = decryptAll(he, encoded, outputs, args, batch);
+    return predictFromLogits(logits, targetValue, preds, verbose);
+}
+
+
+
+IterationResult run_iteration_NN(
+    HEEnv& he,
+    EncodedWeights& encoded,
+    const vector<double>& vals,
+    CampaignArgs& args,
+    size_t targetValue,
+    std::optional<IterationArgs> iterArgs
+) {
+    vector<size_t> preds;
+    return run_iteration_NN_batch(he, encoded, {vals}, args, targetValue, preds, iterArgs);
+}
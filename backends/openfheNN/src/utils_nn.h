@@ -5,25 +5,50 @@
 #include <NTL/ZZ.h>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <sstream>
 
 #include "campaign_helper.h"
 #include "backend_interface.h"
+#include "backend_openfhe.h"
+#include "rotation_key_cache.h"
 #include "utils_ckks.h"
+#include "nn_packing.h"
+#include "parallel_utils.h"
+#include "nn_cache.h"
+#include "nn_profiler.h"
 
 #include "attack_mode.h"
 #include <cassert>
 using namespace lbcrypto;
 using namespace std;
 
+// Rotation steps of reduceSum over a block of 2^logBlock slots. Each level
+// rotates by stride*1 .. stride*(2^radixLog - 1) from one hoisted
+// decomposition, then stride grows by 2^radixLog.
+std::vector<int> reduceSumRotations(uint32_t logBlock, uint32_t radixLog);
+
 struct HEEnv {
     CryptoContext<DCRTPoly> cc;
     KeyPair<DCRTPoly> keys;
-    std::vector<int> rotIdx;
-
+    uint32_t radixLog;
+    // Set by --profile; null keeps the forward unprofiled
+    NNProfiler* profiler = nullptr;
+    // Rotation keys, generated or loaded on first use (requireRotations)
+    std::unique_ptr<RotationKeyCache> rotKeys;
+
+    // No rotation key is generated here: forward and forwardPacked require
+    // the steps of their schedule before rotating. keySeed (--keySeed)
+    // seeds the key generation, so every process gets the same secret key
+    // and can reuse the cached rotation keys; unset, the keys are random.
     HEEnv(uint32_t logN,
           uint32_t multDepth,
           uint32_t scaleMod,
-          uint32_t firstMod) {
+          uint32_t firstMod,
+          const RotationKeyConfig& rotKeyCfg = {},
+          std::optional<uint64_t> keySeed = std::nullopt,
+          uint32_t radixLog_ = 1)
+        : radixLog(radixLog_) {
         auto cfg = SDCConfigHelper::MakeConfig(
             false, // Disable execption
             SecretKeyAttackMode::CompleteInjection
@@ -43,25 +68,79 @@ struct HEEnv {
         cc->Enable(PKE);
         cc->Enable(LEVELEDSHE);
 
+        if (keySeed)
+            PseudoRandomNumberGenerator::GetPRNG().SetSeed(*keySeed);
         keys = cc->KeyGen();
 
         cc->EvalMultKeyGen(keys.secretKey);
 
-        for (int p = 1; p <= 512; p <<= 1) {
-            rotIdx.push_back(p);
-        }
-        cc->EvalAtIndexKeyGen(keys.secretKey, rotIdx);
+        std::ostringstream id;
+        id << "openfheNN logN=" << logN << " multDepth=" << multDepth
+           << " scaleMod=" << scaleMod << " firstMod=" << firstMod
+           << " seed=" << rotKeyCfg.seed
+           << " sk=" << std::hex << secret_key_fingerprint(keys.secretKey);
+        rotKeys = make_rotation_key_cache(cc, keys.secretKey, id.str(), rotKeyCfg);
+    }
+
+    // Rotation keys of steps, generated (or loaded) if missing. Not to be
+    // called from several threads while others rotate.
+    void requireRotations(const std::vector<int>& steps) {
+        rotKeys->require(steps);
     }
 };
 
+// --rotKeyCache/--rotKeyBudgetMB. Without --keySeed every process has its
+// own secret key, so nothing on disk could be reused: keys stay in memory.
+inline RotationKeyConfig rotationKeyConfig(const CampaignArgs& args)
+{
+    RotationKeyConfig cfg{args.rotKeyCache, static_cast<size_t>(args.rotKeyBudgetMB) << 20,
+                          args.keySeed.value_or(0)};
+    if (!cfg.dir.empty() && !args.keySeed) {
+        std::cerr << "[WARN] --rotKeyCache sin --keySeed: claves de rotación solo en memoria\n";
+        cfg.dir.clear();
+    }
+    return cfg;
+}
+
 struct EncodedWeights {
     std::vector<Plaintext> W1;
-    std::vector<Plaintext> b1;
+    std::vector<double> b1;
+
+    std::vector<std::vector<double>> W2;
+    std::vector<double> b2;
+
+    // Packed forward (encodeWeightsPacked): W1 diagonals in giant-major
+    // order, biases and W2 laid out as in nn_packing.h
+    PackedMLPLayout layout{};
+    std::vector<Plaintext> W1diag;
+    Plaintext b1Packed;
+    Plaintext W2Packed;
+    Plaintext b2Packed;
+};
 
-    std::vector<std::vector<Plaintext>> W2;
-    std::vector<Plaintext> b2;
+// Clean forward state of one image batch (buildCleanCache). decrypt faults
+// only touch outputs[targetValue], so run_iteration_NN_batch decrypts that
+// one again and reuses the clean logits of the others. Without iterArgs,
+// run_iteration_NN_batch predicts straight from logits.
+struct NNCleanCache {
+    bool valid = false;
+    std::vector<Ciphertext<DCRTPoly>> outputs;
+    std::vector<std::vector<double>> logits;  // logits[b][o]
 };
 EncodedWeights encodeWeights(
+    HEEnv& he,
+    const vector<vector<double>>& W1,
+    const vector<double>& b1,
+    const vector<vector<double>>& W2,
+    const vector<double>& b2,
+    size_t slots,
+    size_t blockSize = 0   // W1 is repeated every blockSize slots (0 = once)
+);
+
+// Weights for forwardPacked over blocks of `slots` slots. Every plaintext
+// repeats with period `slots` over the whole batch, so rotations act
+// cyclically inside one block.
+EncodedWeights encodeWeightsPacked(
     HEEnv& he,
     const vector<vector<double>>& W1,
     const vector<double>& b1,
@@ -83,21 +162,41 @@ Ciphertext<DCRTPoly> chebyTanh3(
 
 Ciphertext<DCRTPoly> reduceSum(
     HEEnv& he,
-    Ciphertext<DCRTPoly>& ct
+    Ciphertext<DCRTPoly>& ct,
+    size_t logSlots
 );
 
 
+// The HIDDEN neurons run on `threads` threads; layer 2 adds its terms in a
+// fixed tree, so the result does not depend on the thread count.
 vector<Ciphertext<DCRTPoly>> forward(
     HEEnv& he,
     Ciphertext<DCRTPoly> x,
     EncodedWeights& ew,
-    long logSlots,
-    long logP
+    size_t logSlots,
+    size_t threads = 1
+);
+
+// Same network with the packed layout of nn_packing.h: one ciphertext per
+// layer and a single activation. Returns one ciphertext with logit o at
+// slot o*HIDDEN.
+vector<Ciphertext<DCRTPoly>> forwardPacked(
+    HEEnv& he,
+    Ciphertext<DCRTPoly> x,
+    EncodedWeights& ew
 );
 
 vector<double> decryptLogits(HEEnv& he, vector<Ciphertext<DCRTPoly>>& outs
 );
 
+// Packed forward: logit o sits at slot o*stride of the single output
+vector<double> decryptLogitsPacked(HEEnv& he, Ciphertext<DCRTPoly>& out,
+        size_t stride, size_t outputs);
+
+// logits[b][o] of image b, read from slot b*blockSize of each output
+vector<vector<double>> decryptLogitsBatch(HEEnv& he, vector<Ciphertext<DCRTPoly>>& outs,
+        size_t blockSize, size_t batch);
+
 bool loadMnistNormRowByIndex(const std::string &csvPath, size_t rowIndex,
                          size_t &outLabel, std::vector<double> &pixelsOut);
 
@@ -108,4 +207,19 @@ std::vector<double> loadCSVVector(const std::string& path, size_t size);
 
 IterationResult run_iteration_NN(HEEnv& he, EncodedWeights& encoded, const vector<double>& vals, CampaignArgs& args, size_t targetValue, std::optional<IterationArgs> iterArgs=std::nullopt);
 
+// Same inference with images[b] packed in slot block b (1 << logSlots slots
+// each). preds[b] is the prediction of image b; detected refers to image 0.
+IterationResult run_iteration_NN_batch(HEEnv& he, EncodedWeights& encoded,
+        const vector<vector<double>>& images, CampaignArgs& args, size_t targetValue,
+        vector<size_t>& preds, std::optional<IterationArgs> iterArgs=std::nullopt,
+        const NNCleanCache* clean=nullptr);
+
+// Fills clean for images (no faults)
+void buildCleanCache(HEEnv& he, EncodedWeights& encoded,
+        const vector<vector<double>>& images, CampaignArgs& args,
+        NNCleanCache& clean);
+
+// Whether run_iteration_NN_batch can use a clean cache for args.stage
+bool cleanCacheApplies(const CampaignArgs& args);
+
 
@@ -61,6 +61,11 @@ else
     echo "OpenFHE campaigns already built (singleBitFlip found)"
 fi
 
+echo "Building campaign summary tool..."
+cd backends/aggregate
+make
+cd -
+
 echo ""
 echo "=== Setup completed successfully ==="
 echo "Project structure created in: $PROJECT_ROOT/src"
@@ -10,6 +10,7 @@
 
 using cdouble = std::complex<double>;
 struct CampaignArgs;
+struct BitflipResult;
 
 inline void rotate_left(std::vector<double>& v, size_t rot) {
     if (v.empty()) return;
@@ -149,6 +150,8 @@ inline void compute_plain_io(const CampaignArgs& args,
 struct IterationResult {
     std::vector<double> values;
     bool detected;
+    // Filled instead of values when isComplex > 0
+    std::vector<cdouble> complexValues;
 };
 
 struct BackendContext {
@@ -158,7 +161,7 @@ struct BackendContext {
 std::vector<double>
 get_reference_output(const BackendContext* ctx);
 
-std::vector<double>
+const std::vector<cdouble>&
 get_reference_output_complex(const BackendContext* ctx);
 
 BackendContext* setup_campaign(const CampaignArgs& args);
@@ -174,4 +177,13 @@ IterationResult run_iteration_boot(
     std::optional<IterationArgs> iterArgs = std::nullopt
 );
 
+// Runs one flip and grades it against golden (the flip-free run_iteration):
+// the row an exhaustive campaign logs for it
+BitflipResult evaluate_flip(
+    BackendContext* ctx,
+    const CampaignArgs& args,
+    const IterationResult& golden,
+    const IterationArgs& iterArgs
+);
+
 void destroy_campaign(BackendContext* ctx);
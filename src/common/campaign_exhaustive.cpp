@@ -0,0 +1,142 @@
+#include "campaign_exhaustive.h"
+#include "campaign_registry.h"
+#include "campaign_forkserver.h"
+#include "parallel_utils.h"
+#include "thread_budget.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <optional>
+
+void run_exhaustive_campaign(const CampaignArgs& args,
+                             const ExhaustiveEvalFn& evaluate,
+                             const ExhaustiveOptions& opts)
+{
+    CampaignRegistry registry(args);
+    std::cout << "\n=== Registring Campaign "<< std::endl;
+    uint32_t campaign_id = registry.campaign_id;
+
+    std::cout << "\n=== Starting Campaign " << campaign_id << " ===" << std::endl;
+
+    CampaignLogger logger(campaign_id, args.results_dir + "/data", 10000, RecordOptions::from(args));
+    std::cout << "Campaign " << campaign_id << " registered" << std::endl;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    std::cout << "\nStarting bit flip campaign..." << std::endl;
+
+    uint32_t N = 1 << args.logN;
+    size_t num_limbs = args.mult_depth + 1;
+    size_t num_coeffs = N;
+    size_t bits_per_coeff = args.bitPerCoeff;
+    size_t total_expected = num_limbs * num_coeffs * bits_per_coeff;
+    std::vector<double> norms;
+
+    std::cout << "Expected bit flips: " << total_expected << std::endl;
+
+    auto record = [&](const BitflipResult& r) {
+        logger.log(r);
+        if (!r.crashed)
+            norms.push_back(r.norm2);
+    };
+
+    // The flips are walked limb-major, coefficient, bit, and queued
+    // kChunk at a time: the full list would not fit in memory at large logN
+    constexpr size_t kChunk = size_t(1) << 18;
+    const bool reuse = args.existing_policy == ExistingCampaignPolicy::Reuse;
+    std::vector<IterationArgs> items;
+    items.reserve(std::min(kChunk, total_expected));
+    size_t cursor = 0;
+    size_t skipped = 0;
+    auto nextChunk = [&] {
+        items.clear();
+        while (cursor < total_expected && items.size() < kChunk) {
+            IterationArgs iterArgs(cursor / (num_coeffs * bits_per_coeff),
+                                   (cursor / bits_per_coeff) % num_coeffs,
+                                   cursor % bits_per_coeff);
+            ++cursor;
+            if (reuse && logger.contains(iterArgs)) {
+                ++skipped;
+                continue;
+            }
+            items.push_back(iterArgs);
+        }
+        return !items.empty();
+    };
+    bool pending = nextChunk();
+
+    // --cores: split the budget between iteration threads and the
+    // OpenMP threads the library uses inside each of them
+    const bool threaded = opts.sharedContextThreads && args.workers == 0;
+    const bool budget = threaded && args.cores > 0;
+    ThreadSplit split;
+    split.workers = threaded ? std::max<uint32_t>(args.threads, 1) : 1;
+    if (budget) {
+        if (args.autotune > 0 && !items.empty()) {
+            std::atomic<size_t> probeNext{0};
+            split = autotune_split(args.cores, args.autotune, args.pinCores,
+                [&](uint32_t) {
+                    evaluate(items[probeNext++ % items.size()]);
+                });
+        } else {
+            split = heuristic_split(args.cores, args.logN, args.mult_depth + 1, args.stage);
+        }
+        std::cout << "Thread split (" << split.source << "): " << split.workers
+                  << " x " << split.ompThreads << " OpenMP" << std::endl;
+        registry.register_meta("cores", std::to_string(args.cores));
+        registry.register_meta("iteration_threads", std::to_string(split.workers));
+        registry.register_meta("omp_threads", std::to_string(split.ompThreads));
+        registry.register_meta("pinned", std::to_string(args.pinCores));
+        registry.register_meta("split_source", split.source);
+        if (split.source == "autotune")
+            registry.register_meta("probe_iters_per_sec", std::to_string(split.itersPerSec));
+    }
+
+    const bool parallel = args.workers == 0 && (budget || split.workers > 1);
+    std::optional<SavedThreadSettings> saved;
+    if (parallel)
+        saved.emplace();
+    for (; pending; pending = nextChunk()) {
+        if (args.workers > 0) {
+            ForkServerOptions fs_opts;
+            fs_opts.workers = args.workers;
+            fs_opts.timeout_seconds = args.workerTimeout;
+            run_fork_server(items, fs_opts, evaluate, record);
+        } else if (parallel) {
+            // Threads share the context (read-only); each one replays the
+            // encryption randomness on its own PRNG. Only the logger and norms
+            // are serialized. parallel_for starts new threads per chunk, so
+            // the split is applied again.
+            std::mutex recordMutex;
+            std::vector<char> applied(split.workers, 0);
+            parallel_for(items.size(), split.workers, [&](size_t i, size_t worker) {
+                if (budget && !applied[worker]) {
+                    apply_thread_split(split, static_cast<uint32_t>(worker), args.pinCores);
+                    applied[worker] = 1;
+                }
+                BitflipResult r = evaluate(items[i]);
+                std::lock_guard<std::mutex> lock(recordMutex);
+                record(r);
+            });
+        } else {
+            for (const auto& iterArgs : items)
+                record(evaluate(iterArgs));
+        }
+    }
+    if (skipped)
+        std::cout << "Skipped " << skipped << " already computed iterations" << std::endl;
+    if (args.workers > 0)
+        std::cout << "Crashed iterations: " << logger.crashed() << std::endl;
+    std::sort(norms.begin(), norms.end());
+    double l2_P95 = percentile(norms, 0.95);
+    double l2_P99 = percentile(norms, 0.99);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::seconds duration = std::chrono::duration_cast<std::chrono::seconds>(end_time - start_time);
+    auto minutes = std::chrono::duration_cast<std::chrono::minutes>(duration);
+    uint64_t mins = minutes.count();
+
+    registry.register_end({campaign_id, logger.total(), logger.sdc(), mins, l2_P95, l2_P99, timestamp_now()});
+}
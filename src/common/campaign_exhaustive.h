@@ -0,0 +1,25 @@
+#pragma once
+#include <functional>
+#include "campaign_helper.h"
+#include "campaign_logger.h"
+
+// Loop of an exhaustive single-bit-flip campaign, shared by
+// exhaustiveSingleBitFlip and sweepSingleBitFlip: registers the campaign,
+// flips every (limb, coeff, bit) with limb <= mult_depth (skipping those
+// already logged under Reuse) and registers its end.
+//
+// The flips run through the fork server (--workers), on iteration threads
+// (--threads, --cores split by thread_budget) or in order on the caller.
+// Threads are only used when the backend context can be shared by them.
+
+// Runs one flip and grades it against the golden output (evaluate_flip)
+using ExhaustiveEvalFn = std::function<BitflipResult(const IterationArgs&)>;
+
+struct ExhaustiveOptions {
+    // evaluate may run concurrently on one context (--threads, --cores)
+    bool sharedContextThreads = false;
+};
+
+void run_exhaustive_campaign(const CampaignArgs& args,
+                             const ExhaustiveEvalFn& evaluate,
+                             const ExhaustiveOptions& opts = {});
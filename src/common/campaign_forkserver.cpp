@@ -0,0 +1,348 @@
+#include "campaign_forkserver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+constexpr uint64_t kNone = std::numeric_limits<uint64_t>::max();
+
+// Lives in a MAP_SHARED page so the parent can see what each worker is on.
+struct WorkerSlot {
+    std::atomic<uint64_t> current;     // item being evaluated, kNone if none yet
+    std::atomic<uint64_t> range_begin; // range the worker holds
+    std::atomic<uint64_t> range_end;
+    std::atomic<int64_t>  started_ms;
+};
+
+struct SharedQueue {
+    std::atomic<uint64_t> next;
+    WorkerSlot slots[1]; // really opts.workers entries
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "fork server needs lock-free 64-bit atomics in shared memory");
+
+struct WireRecord {
+    uint64_t index;
+    BitflipResult result;
+};
+static_assert(std::is_trivially_copyable<WireRecord>::value,
+              "WireRecord is sent raw through a pipe");
+
+struct Worker {
+    pid_t pid = -1;
+    int fd = -1;
+    uint64_t first = 0;     // leftover range it was forked with
+    uint64_t last = 0;
+    uint64_t received = kNone;
+    uint32_t empty_deaths = 0;
+    std::vector<char> pending;
+};
+
+int64_t now_ms()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool write_all(int fd, const void* data, size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Threads of this process (/proc/self/task), 0 if it cannot be read
+size_t process_threads()
+{
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir)
+        return 0;
+    size_t n = 0;
+    while (const dirent* e = readdir(dir))
+        if (e->d_name[0] != '.')
+            n++;
+    closedir(dir);
+    return n;
+}
+
+BitflipResult crash_result(const IterationArgs& it)
+{
+    BitflipResult r{};
+    r.limb = it.limb;
+    r.coeff = it.coeff;
+    r.bit = it.bit;
+    r.norm2 = std::numeric_limits<double>::quiet_NaN();
+    r.rel_error = std::numeric_limits<double>::quiet_NaN();
+    r.crashed = true;
+    return r;
+}
+
+[[noreturn]] void worker_main(SharedQueue* q, WorkerSlot& slot, int fd,
+                              uint64_t b, uint64_t e,
+                              const std::vector<IterationArgs>& items,
+                              const ForkServerOptions& opts,
+                              const ForkIterationFn& iterate)
+{
+    const uint64_t n = items.size();
+    for (;;) {
+        if (b >= e) {
+            b = q->next.fetch_add(opts.chunk);
+            if (b >= n) break;
+            e = std::min<uint64_t>(b + opts.chunk, n);
+        }
+        slot.range_begin.store(b);
+        slot.range_end.store(e);
+        for (; b < e; ++b) {
+            slot.started_ms.store(now_ms());
+            slot.current.store(b);
+
+            WireRecord rec{b, {}};
+            try {
+                rec.result = iterate(items[b]);
+            } catch (...) {
+                // A library exception is the same outcome as an abort
+                rec.result = crash_result(items[b]);
+            }
+            if (!write_all(fd, &rec, sizeof(rec)))
+                _exit(3);
+        }
+    }
+    close(fd);
+    _exit(0);
+}
+
+} // namespace
+
+void prepare_fork_server()
+{
+    setenv("OMP_NUM_THREADS", "1", 1);
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+#endif
+}
+
+uint64_t run_fork_server(const std::vector<IterationArgs>& items,
+                         const ForkServerOptions& opts,
+                         const ForkIterationFn& iterate,
+                         const ForkResultFn& on_result)
+{
+    if (opts.workers == 0 || opts.chunk == 0)
+        throw std::invalid_argument("run_fork_server: workers y chunk deben ser > 0");
+    if (items.empty())
+        return 0;
+    // A child only inherits the forking thread: a live OpenMP pool (or any
+    // other thread) would leave its locks and workers behind.
+    if (process_threads() > 1)
+        throw std::runtime_error("run_fork_server: el proceso ya tiene varios threads; "
+                                 "llamar a prepare_fork_server() antes de setup_campaign");
+
+    const size_t shm_size = sizeof(SharedQueue) + (opts.workers - 1) * sizeof(WorkerSlot);
+    void* mem = mmap(nullptr, shm_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        throw std::runtime_error("run_fork_server: mmap fallo (errno=" + std::to_string(errno) + ")");
+
+    auto* q = static_cast<SharedQueue*>(mem);
+    new (&q->next) std::atomic<uint64_t>(0);
+    for (uint32_t w = 0; w < opts.workers; ++w) {
+        new (&q->slots[w].current) std::atomic<uint64_t>(kNone);
+        new (&q->slots[w].range_begin) std::atomic<uint64_t>(0);
+        new (&q->slots[w].range_end) std::atomic<uint64_t>(0);
+        new (&q->slots[w].started_ms) std::atomic<int64_t>(0);
+    }
+
+    std::vector<Worker> workers(opts.workers);
+    // Items with a result (or a crash report) in the parent
+    std::vector<char> done(items.size(), 0);
+
+    auto spawn = [&](uint32_t w, uint64_t first, uint64_t last) {
+        int fds[2];
+        if (pipe(fds) != 0)
+            throw std::runtime_error("run_fork_server: pipe fallo (errno=" + std::to_string(errno) + ")");
+
+        WorkerSlot& slot = q->slots[w];
+        slot.current.store(kNone);
+        slot.range_begin.store(first);
+        slot.range_end.store(last);
+        slot.started_ms.store(0);
+
+        // Unflushed stdio buffers would otherwise be written twice.
+        std::cout.flush();
+        std::cerr.flush();
+
+        pid_t pid = fork();
+        if (pid < 0)
+            throw std::runtime_error("run_fork_server: fork fallo (errno=" + std::to_string(errno) + ")");
+        if (pid == 0) {
+            close(fds[0]);
+            worker_main(q, slot, fds[1], first, last, items, opts, iterate);
+        }
+        close(fds[1]);
+
+        Worker& wk = workers[w];
+        wk.pid = pid;
+        wk.fd = fds[0];
+        wk.first = first;
+        wk.last = last;
+        wk.received = kNone;
+        wk.pending.clear();
+    };
+
+    uint64_t crashes = 0;
+
+    auto drain = [&](Worker& wk) -> bool {
+        char buf[64 * sizeof(WireRecord)];
+        ssize_t n = read(wk.fd, buf, sizeof(buf));
+        if (n < 0)
+            return errno == EINTR || errno == EAGAIN;
+        if (n == 0)
+            return false;
+
+        wk.pending.insert(wk.pending.end(), buf, buf + n);
+        size_t off = 0;
+        while (wk.pending.size() - off >= sizeof(WireRecord)) {
+            WireRecord rec;
+            std::memcpy(&rec, wk.pending.data() + off, sizeof(rec));
+            off += sizeof(rec);
+            wk.received = rec.index;
+            done[rec.index] = 1;
+            if (rec.result.crashed) crashes++;
+            on_result(rec.result);
+        }
+        wk.pending.erase(wk.pending.begin(), wk.pending.begin() + off);
+        return true;
+    };
+
+    // Worker w closed its pipe: reap it and, if it did not finish cleanly,
+    // report its in-flight item and fork a replacement for the rest.
+    auto reap = [&](uint32_t w) {
+        Worker& wk = workers[w];
+        int status = 0;
+        while (waitpid(wk.pid, &status, 0) < 0 && errno == EINTR) {}
+        close(wk.fd);
+        wk.fd = -1;
+        wk.pid = -1;
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+            return;
+
+        const WorkerSlot& slot = q->slots[w];
+        const uint64_t cur = slot.current.load();
+        uint64_t resume_first, resume_last;
+
+        if (cur == kNone) {
+            // Died before its first item: retry the same range a few times.
+            if (++wk.empty_deaths > 3)
+                throw std::runtime_error("run_fork_server: el worker muere antes de empezar");
+            resume_first = wk.first;
+            resume_last = wk.last;
+        } else {
+            wk.empty_deaths = 0;
+            if (cur != wk.received) {
+                done[cur] = 1;
+                on_result(crash_result(items[cur]));
+                crashes++;
+                std::cerr << "[WARN] worker " << w << " crashed on item " << cur
+                          << (WIFSIGNALED(status) ? " (signal " + std::to_string(WTERMSIG(status)) + ")" : "")
+                          << std::endl;
+            }
+            // cur may still point into the previous range if the worker
+            // died right after claiming a new one.
+            resume_first = std::max(cur + 1, slot.range_begin.load());
+            resume_last = slot.range_end.load();
+        }
+        spawn(w, resume_first, resume_last);
+    };
+
+    for (uint32_t w = 0; w < opts.workers; ++w)
+        spawn(w, 0, 0);
+
+    const int64_t timeout_ms = static_cast<int64_t>(opts.timeout_seconds) * 1000;
+    std::vector<pollfd> pfds;
+    std::vector<uint32_t> owner;
+
+    for (;;) {
+        pfds.clear();
+        owner.clear();
+        for (uint32_t w = 0; w < opts.workers; ++w) {
+            if (workers[w].fd >= 0) {
+                pfds.push_back({workers[w].fd, POLLIN, 0});
+                owner.push_back(w);
+            }
+        }
+        if (pfds.empty())
+            break;
+
+        int ready = poll(pfds.data(), pfds.size(), 200);
+        if (ready < 0 && errno != EINTR)
+            throw std::runtime_error("run_fork_server: poll fallo (errno=" + std::to_string(errno) + ")");
+
+        for (size_t i = 0; ready > 0 && i < pfds.size(); ++i) {
+            if (pfds[i].revents == 0)
+                continue;
+            if (!drain(workers[owner[i]]))
+                reap(owner[i]);
+        }
+
+        if (timeout_ms == 0)
+            continue;
+        const int64_t now = now_ms();
+        for (uint32_t w = 0; w < opts.workers; ++w) {
+            const Worker& wk = workers[w];
+            if (wk.pid < 0)
+                continue;
+            const WorkerSlot& slot = q->slots[w];
+            const uint64_t cur = slot.current.load();
+            if (cur != kNone && cur != wk.received &&
+                now - slot.started_ms.load() > timeout_ms) {
+                // The pipe hits EOF after the kill and reap() handles it
+                kill(wk.pid, SIGKILL);
+            }
+        }
+    }
+
+    munmap(mem, shm_size);
+
+    // A worker that died between claiming a chunk from the queue and
+    // publishing it in its slot took the chunk with it: run what is left.
+    std::vector<IterationArgs> rest;
+    for (size_t i = 0; i < items.size(); ++i)
+        if (!done[i])
+            rest.push_back(items[i]);
+    if (!rest.empty()) {
+        std::cerr << "[WARN] " << rest.size() << " items without result, running them again"
+                  << std::endl;
+        crashes += run_fork_server(rest, opts, iterate, on_result);
+    }
+    return crashes;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "campaign_helper.h"
+#include "campaign_logger.h"
+
+// Fork-server execution of a campaign: the caller builds the context once,
+// then `workers` child processes inherit it copy-on-write and pull ranges
+// of `items` from a shared queue. Results come back to the parent over a
+// pipe per worker, so only the parent touches the logger and the registry.
+//
+// A worker that dies (signal, abort, non-zero exit) or spends more than
+// `timeout_seconds` on one iteration is killed, its in-flight iteration is
+// reported with crashed = true, and a new worker is forked to finish the
+// rest of its range. Items left without a result (a worker that died
+// between claiming a chunk and publishing it) are run again at the end.
+//
+// fork() only copies the calling thread, so the parent must still be
+// single-threaded when run_fork_server starts: call prepare_fork_server()
+// before setup_campaign, which keeps OpenMP (used by OpenFHE) from starting
+// a thread pool. run_fork_server throws if the process has other threads.
+struct ForkServerOptions {
+    uint32_t workers = 1;
+    uint32_t timeout_seconds = 60;
+    uint64_t chunk = 64;
+};
+
+using ForkIterationFn = std::function<BitflipResult(const IterationArgs&)>;
+using ForkResultFn    = std::function<void(const BitflipResult&)>;
+
+// OMP_NUM_THREADS=1 and omp_set_num_threads(1)
+void prepare_fork_server();
+
+// Runs every item once and calls on_result in the parent for each of them
+// (order is not preserved). Returns the number of crashed iterations.
+uint64_t run_fork_server(const std::vector<IterationArgs>& items,
+                         const ForkServerOptions& opts,
+                         const ForkIterationFn& iterate,
+                         const ForkResultFn& on_result);
@@ -6,6 +6,7 @@
 #include <chrono>
 #include <iomanip>
 #include <sstream>
+#include <stdexcept>
 
 
 
@@ -44,6 +45,27 @@ void CampaignArgs::print(std::ostream& os) const {
     os << "amountBits: " << amountBits << '\n';
     os << "scaleTech: " << scaleTech << '\n';
     os << "results_dir: " << results_dir << '\n';
+    os << "nnBatch: " << nnBatch << '\n';
+    os << "nnPacked: " << nnPacked << '\n';
+    os << "threads: " << threads << '\n';
+    os << "rows: " << rows << '\n';
+    os << "profile: " << profile << '\n';
+    os << "workers: " << workers << '\n';
+    os << "workerTimeout: " << workerTimeout << '\n';
+    os << "decryptDelta: " << decryptDelta << '\n';
+    os << "cores: " << cores << '\n';
+    os << "pinCores: " << pinCores << '\n';
+    os << "autotune: " << autotune << '\n';
+    os << "snapshots: " << snapshots << '\n';
+    os << "thresholdsSKA: " << thresholdsSKA << '\n';
+    os << "rotKeyCache: " << rotKeyCache << '\n';
+    os << "rotKeyBudgetMB: " << rotKeyBudgetMB << '\n';
+    if (keySeed)
+        os << "keySeed: " << *keySeed << '\n';
+    else
+        os << "keySeed: <none>\n";
+    os << "record: " << record << '\n';
+    os << "recordCoeff: " << recordCoeff << '\n';
 
     if (openfhe_attack_mode)
         os << "openfhe_attack_mode: " << static_cast<int>(*openfhe_attack_mode) << '\n';
@@ -91,6 +113,24 @@ void print_usage(const char* program_name) {
               << "  --amountBits <value>    Amount of burst bits (default: 1)\n"
               << "  --scaleTech <value>     Scaling technique (default: FIXEDMANUAL, others: FIXEDAUTO, FLEXIBLEAUTO or FLEXIBLEAUTOEXT)\n"
               << "  --results_dir <path>    Results directory (default: results)\n"
+              << "  --nnBatch <value>       Images per ciphertext in NN campaigns, power of 2 (default: 1)\n"
+              << "  --nnPacked <0/1>        Packed NN forward, hidden layer in one ciphertext (default: 0)\n"
+              << "  --threads <value>       Threads for the NN forward / OpenFHE exhaustive iterations (default: 1)\n"
+              << "  --profile <0/1>         Profile the NN forward per layer and neuron into results_dir/data (default: 0)\n"
+              << "  --rows <list>           MNIST rows to sweep in one NN process, e.g. 0-999 or 3,7,10-20 (default: --seed)\n"
+              << "  --workers <value>       Fork-server workers for exhaustive campaigns (default: 0, in-process)\n"
+              << "  --workerTimeout <value> Seconds before a stuck worker is killed (default: 60, 0 = never)\n"
+              << "  --decryptDelta <0/1>    OpenFHE decrypt stages: recompute only the faulted limb (default: 0)\n"
+              << "  --cores <value>         OpenFHE exhaustive: cores split into iteration x OpenMP threads (default: 0 = off)\n"
+              << "  --pinCores <0/1>        With --cores: pin iteration threads to cores (default: 0)\n"
+              << "  --autotune <value>      With --cores: probe iterations per thread to pick the split (default: 0 = heuristic)\n"
+              << "  --snapshots <0/1>       Reuse clean pipeline ciphertexts from results_dir/snapshots (default: 0)\n"
+              << "  --thresholdsSKA <list>  OpenFHE detectorBench: SKA thresholds to compare (default: 3,5,8,12)\n"
+              << "  --rotKeyCache <dir>     OpenFHE: persist rotation keys in dir and reuse them across processes (default: memory only)\n"
+              << "  --rotKeyBudgetMB <value> OpenFHE: resident rotation keys before eviction (default: 0 = no limit)\n"
+              << "  --keySeed <value>       OpenFHE NN: seed the key generation; needed to share --rotKeyCache (default: random)\n"
+              << "  --record <mode>         rows: one CSV row per flip; aggregate: per-bit/limb summaries written at the end (default: rows)\n"
+              << "  --recordCoeff <0/1>     With --record aggregate: add per-coefficient cells (default: 0)\n"
               << "  --verbose, -v           Verbose output\n"
               << "  --help, -h              Show this help\n\n"
               << "Examples:\n"
@@ -131,6 +171,24 @@ CampaignArgs parse_arguments(int argc, char* argv[]) {
         {"amountBits",     required_argument, 0, 'J'},
         {"scaleTech",      required_argument, 0, 'C'},
         {"results_dir",    required_argument, 0, 'R'},
+        {"nnBatch",        required_argument, 0, 'k'},
+        {"nnPacked",       required_argument, 0, 'P'},
+        {"threads",        required_argument, 0, 'j'},
+        {"rows",           required_argument, 0, 'I'},
+        {"profile",        required_argument, 0, 'F'},
+        {"workers",        required_argument, 0, 'W'},
+        {"workerTimeout",  required_argument, 0, 'w'},
+        {"decryptDelta",   required_argument, 0, 'E'},
+        {"cores",          required_argument, 0, 'K'},
+        {"pinCores",       required_argument, 0, 'Z'},
+        {"autotune",       required_argument, 0, 'G'},
+        {"snapshots",      required_argument, 0, 'Y'},
+        {"thresholdsSKA",  required_argument, 0, 'V'},
+        {"rotKeyCache",    required_argument, 0, 'H'},
+        {"rotKeyBudgetMB", required_argument, 0, 'U'},
+        {"keySeed",        required_argument, 0, 'e'},
+        {"record",         required_argument, 0, 'q'},
+        {"recordCoeff",    required_argument, 0, 'u'},
         {"verbose",        no_argument,       0, 'v'},
         {"help",           no_argument,       0, 'h'},
         {0, 0, 0, 0}
@@ -140,7 +198,7 @@ CampaignArgs parse_arguments(int argc, char* argv[]) {
 
     while ((opt = getopt_long(
         argc, argv,
-        "S:c:N:Q:d:g:m:n:A:p:M:L:r:B:o:O:X:T:x:y:s:b:a:t:D:C:R:v:h",
+        "S:c:N:Q:d:g:m:n:A:p:M:L:r:B:o:O:X:T:x:y:s:b:a:t:D:C:R:k:P:j:I:F:W:w:E:K:Z:G:Y:V:H:U:e:q:u:v:h",
         long_options,
         &option_index)) != -1)
     {
@@ -168,6 +226,47 @@ CampaignArgs parse_arguments(int argc, char* argv[]) {
             case 'o': args.op_step = std::stoul(optarg); break;
             case 'O': args.op_depth = std::stoul(optarg); break;
             case 'J': args.amountBits = std::stoul(optarg); break;
+            case 'k': args.nnBatch = std::stoul(optarg); break;
+            case 'P': args.nnPacked = std::stoul(optarg); break;
+            case 'j': args.threads = std::stoul(optarg); break;
+            case 'F': args.profile = std::stoul(optarg); break;
+            case 'I':
+                args.rows = optarg;
+                try {
+                    parse_row_list(args.rows);
+                } catch (const std::exception& e) {
+                    std::cerr << "Invalid value for --rows: " << e.what() << "\n";
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
+            case 'W': args.workers = std::stoul(optarg); break;
+            case 'w': args.workerTimeout = std::stoul(optarg); break;
+            case 'E': args.decryptDelta = std::stoul(optarg); break;
+            case 'K': args.cores = std::stoul(optarg); break;
+            case 'Z': args.pinCores = std::stoul(optarg); break;
+            case 'G': args.autotune = std::stoul(optarg); break;
+            case 'Y': args.snapshots = std::stoul(optarg); break;
+            case 'H': args.rotKeyCache = optarg; break;
+            case 'U': args.rotKeyBudgetMB = std::stoul(optarg); break;
+            case 'e': args.keySeed = std::stoull(optarg); break;
+            case 'q':
+                args.record = optarg;
+                if (args.record != "rows" && args.record != "aggregate") {
+                    std::cerr << "Invalid value for --record: " << args.record
+                              << " (rows or aggregate)\n";
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
+            case 'u': args.recordCoeff = std::stoul(optarg); break;
+            case 'V':
+                args.thresholdsSKA = optarg;
+                try {
+                    parse_double_list(args.thresholdsSKA);
+                } catch (const std::exception& e) {
+                    std::cerr << "Invalid value for --thresholdsSKA: " << e.what() << "\n";
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
 
             case 'v':
                 args.verbose = true;
@@ -267,3 +366,49 @@ CampaignArgs parse_arguments(int argc, char* argv[]) {
 }
 
 
+
+std::vector<uint32_t> parse_row_list(const std::string& rows)
+{
+    std::vector<uint32_t> out;
+    std::stringstream ss(rows);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty())
+            continue;
+        size_t dash = item.find('-');
+        // The whole bound must be a uint32: "3x" or "1-2-3" are errors
+        auto bound = [&](const std::string& substr) {
+            size_t pos = 0;
+            unsigned long v = std::stoul(substr, &pos);
+            if (pos != substr.size() || v > UINT32_MAX)
+                throw std::invalid_argument("fila no valida '" + item + "'");
+            return static_cast<uint32_t>(v);
+        };
+        uint32_t first = bound(item.substr(0, dash));
+        uint32_t last = first;
+        if (dash != std::string::npos)
+            last = bound(item.substr(dash + 1));
+        if (last < first)
+            throw std::invalid_argument("rango vacio '" + item + "'");
+        for (uint64_t r = first; r <= last; ++r)
+            out.push_back(static_cast<uint32_t>(r));
+    }
+    if (out.empty())
+        throw std::invalid_argument("lista de filas vacia '" + rows + "'");
+    return out;
+}
+
+std::vector<double> parse_double_list(const std::string& list)
+{
+    std::vector<double> out;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty())
+            continue;
+        out.push_back(std::stod(item));
+    }
+    if (out.empty())
+        throw std::invalid_argument("lista vacia '" + list + "'");
+    return out;
+}
@@ -64,6 +64,49 @@ struct CampaignArgs {
     uint32_t amountBits = 1;
     std::string scaleTech = "FIXEDMANUAL";
     std::string results_dir = "../../results";
+    // NN campaigns: images packed per ciphertext, one per 1 << logSlots block
+    uint32_t nnBatch = 1;
+    // NN campaigns: packed (diagonal/BSGS) forward, whole hidden layer in one ciphertext
+    uint32_t nnPacked = 0;
+    // NN campaigns: threads for the hidden neurons and layer 2 of forward.
+    // OpenFHE exhaustive (workers = 0): threads running iterations on one context
+    uint32_t threads = 1;
+    // NN campaigns: MNIST rows to sweep ("0-999", "3,7,10-20"); one campaign
+    // per row with seed = row. Empty runs the single row `seed`.
+    std::string rows;
+    // NN campaigns: per-layer/per-neuron timers and op counters (nn_profiler.h)
+    uint32_t profile = 0;
+    // Fork-server workers for exhaustive campaigns (0 = run in-process)
+    uint32_t workers = 0;
+    uint32_t workerTimeout = 60;
+    // OpenFHE decrypt_c0/decrypt_c1: recompute only the faulted limb of c0 + c1*s
+    uint32_t decryptDelta = 0;
+    // OpenFHE exhaustive: core budget split between iteration threads and
+    // OpenMP threads (thread_budget.h); 0 keeps --threads and OMP_NUM_THREADS
+    uint32_t cores = 0;
+    // With cores: pin each iteration thread and its OpenMP threads to cores
+    uint32_t pinCores = 0;
+    // With cores: probe iterations per thread to time every split (0 = heuristic)
+    uint32_t autotune = 0;
+    // Clean ciphertext after encrypt and after each server op, shared through
+    // results_dir/snapshots (snapshot_store.h); iterations start from them
+    uint32_t snapshots = 0;
+    // OpenFHE detectorBench: SKA thresholds (bits) judged on every flip, "5,8,12"
+    std::string thresholdsSKA = "3,5,8,12";
+    // OpenFHE: rotation keys generated on first use and persisted in this
+    // directory (rotation_key_cache.h); empty keeps them in memory only
+    std::string rotKeyCache;
+    // Resident rotation keys before the least recently used are evicted (0 = no limit)
+    uint32_t rotKeyBudgetMB = 0;
+    // OpenFHE NN: seed of the key generation (and of the encryption drawn
+    // after it); unset keeps the keys random. --rotKeyCache needs it to
+    // share keys across processes
+    std::optional<uint64_t> keySeed;
+    // CampaignLogger output: "rows" (one CSV row per flip) or "aggregate"
+    // (campaign_summary.h accumulators, written once at close)
+    std::string record = "rows";
+    // With record aggregate: also per-coefficient cells
+    uint32_t recordCoeff = 0;
 
 
     std::optional<AttackModeSKA> openfhe_attack_mode = AttackModeSKA::CompleteInjection;
@@ -75,6 +118,10 @@ struct CampaignArgs {
 
 void print_usage(const char* program_name);
 CampaignArgs parse_arguments(int argc, char* argv[]);
+// Expands a --rows list: comma separated indices and inclusive a-b ranges
+std::vector<uint32_t> parse_row_list(const std::string& rows);
+// Comma separated doubles (--thresholdsSKA)
+std::vector<double> parse_double_list(const std::string& list);
 
 
 struct CampaignContext {
@@ -1,28 +1,48 @@
 #include "campaign_logger.h"
+#include <cerrno>
+#include <charconv>
+#include <fcntl.h>
+#include <unistd.h>
 
 
 namespace fs = std::filesystem;
 
 std::string BitflipResult::header() {
-    return "limb,coeff,bit,l2_norm,rel_error,is_sdc,correct,degraded,corrupted,failed,hidden_layer,reduceSum_layer";
+    return "limb,coeff,bit,l2_norm,rel_error,is_sdc,correct,degraded,corrupted,failed,hidden_layer,reduceSum_layer,crashed,mod_error,phase_error";
+}
+
+void BitflipResult::encode(CsvEncoder& out) const {
+    out.add(limb).add(coeff).add(bit)
+       .add(norm2)
+       .add(rel_error).add(is_sdc)
+       .add(stats.correct).add(stats.degraded)
+       .add(stats.corrupted).add(stats.failed)
+       .add(hidden_layer).add(reduceSum_layer)
+       .add(crashed)
+       .add(mod_error).add(phase_error);
+    out.endRow();
 }
 
 std::string BitflipResult::row() const {
-    std::ostringstream ss;
-    ss << limb << "," << coeff << "," << bit << ","
-       << norm2 << ","
-       << rel_error << "," << (is_sdc ? 1 : 0) << ","
-       << stats.correct << "," << stats.degraded << ","
-       << stats.corrupted << "," << stats.failed<< ","
-       << hidden_layer << "," << reduceSum_layer;
-    return ss.str();
+    CsvEncoder out(256);
+    encode(out);
+    return std::string(out.data(), out.size() - 1);
 }
 
 
+RecordOptions RecordOptions::from(const CampaignArgs& args) {
+    RecordOptions r;
+    r.aggregate = args.record == "aggregate";
+    r.perCoeff = args.recordCoeff != 0;
+    return r;
+}
+
 CampaignLogger::CampaignLogger(uint32_t id,
                                const std::string& dir,
-                               size_t flush_th)
-    : flush_threshold_(flush_th)
+                               size_t flush_th,
+                               RecordOptions record)
+    : campaign_id_(id), dir_(dir), buffer_(record.aggregate ? 1024 : flush_th * 96),
+      flush_threshold_(flush_th)
 {
     fs::create_directories(dir);
 
@@ -31,13 +51,24 @@ CampaignLogger::CampaignLogger(uint32_t id,
          << std::setfill('0') << id << ".csv";
     csv_path_ = path.str();
 
+    if (record.aggregate) {
+        aggregated_ = true;
+        summary_ = std::make_unique<CampaignSummary>(record.perCoeff, true);
+        return;
+    }
+
     const bool write_header =
         !fs::exists(csv_path_) || fs::file_size(csv_path_) == 0;
 
-    file_.open(csv_path_, std::ios::out | std::ios::app);
+    fd_ = ::open(csv_path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        throw std::runtime_error("CampaignLogger: no se pudo abrir " + csv_path_ +
+                                 " (errno=" + std::to_string(errno) + ")");
 
     if (write_header) {
-        file_ << BitflipResult::header() << "\n";
+        buffer_.raw(BitflipResult::header());
+        buffer_.endRow();
+        buffer_.flushTo(fd_, csv_path_);
     }
 }
 
@@ -45,16 +76,27 @@ CampaignLogger::CampaignLogger(uint32_t id,
 
 
 CampaignLogger::~CampaignLogger() {
-    close();
+    try {
+        close();
+    } catch (const std::exception& e) {
+        std::cerr << "[WARN] " << e.what() << std::endl;
+    }
 }
 
 void CampaignLogger::log(const BitflipResult& r) {
     std::lock_guard<std::mutex> g(mtx_);
-    buffer_.push_back(r.row());
     total_++;
     if (r.is_sdc) sdc_++;
+    if (r.crashed) crashed_++;
+    if (aggregated_) {
+        if (summary_)
+            summary_->add(r.limb, r.coeff, r.bit, r.norm2, r.is_sdc, r.stats, r.crashed);
+        return;
+    }
+    r.encode(buffer_);
+    pending_++;
 
-    if (buffer_.size() >= flush_threshold_)
+    if (pending_ >= flush_threshold_)
         flush();
 }
 
@@ -77,15 +119,49 @@ void CampaignLogger::log(uint32_t limb, uint32_t coeff, uint32_t bit,
     }
 
 void CampaignLogger::flush() {
-    for (auto& l : buffer_)
-        file_ << l << "\n";
-    buffer_.clear();
-    file_.flush();
+    if (fd_ >= 0)
+        buffer_.flushTo(fd_, csv_path_);
+    else
+        buffer_.clear();
+    pending_ = 0;
+}
+
+void CampaignLogger::write_summary() {
+    std::ostringstream path;
+    path << dir_ << "/summary_" << std::setw(6)
+         << std::setfill('0') << campaign_id_ << ".csv";
+    const std::string p = path.str();
+
+    int fd = ::open(p.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("CampaignLogger: no se pudo abrir " + p +
+                                 " (errno=" + std::to_string(errno) + ")");
+    CsvEncoder out;
+    out.raw("campaign_id").raw(CampaignSummary::header());
+    out.endRow();
+    summary_->encode(out, std::to_string(campaign_id_));
+    try {
+        out.flushTo(fd, p);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    summary_.reset();
+    std::cout << "[INFO] Campaign summary → " << p << std::endl;
 }
 
 void CampaignLogger::close() {
+    if (aggregated_) {
+        if (summary_)
+            write_summary();
+        return;
+    }
     flush();
-    file_.close();
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
     compress_and_cleanup();
 
 }
@@ -104,39 +180,42 @@ void CampaignLogger::compress_and_cleanup() {
     std::cout << "[INFO] Compressed campaign data → " << gz_path << std::endl;
 }
 
-bool CampaignLogger::contains(const IterationArgs& args) const
+uint64_t CampaignLogger::flip_key(uint32_t limb, uint32_t coeff, uint32_t bit)
 {
-    std::ifstream file(csv_path_);
+    return (static_cast<uint64_t>(limb) << 40) | (static_cast<uint64_t>(coeff) << 8) | bit;
+}
 
+void CampaignLogger::load_logged() const
+{
+    std::ifstream file(csv_path_);
     if (!file.is_open())
-        return false;
+        return;
 
     std::string line;
-
-    // header
-    std::getline(file, line);
-
-    while (std::getline(file, line))
-    {
-        std::stringstream ss(line);
-        std::string field;
-
-        std::getline(ss, field, ',');
-        uint32_t limb = std::stoul(field);
-
-        std::getline(ss, field, ',');
-        uint32_t coeff = std::stoul(field);
-
-        std::getline(ss, field, ',');
-        uint32_t bit = std::stoul(field);
-
-        if (limb == args.limb &&
-            coeff == args.coeff &&
-            bit == args.bit)
-        {
-            return true;
+    std::getline(file, line); // header
+    while (std::getline(file, line)) {
+        // limb,coeff,bit are the first three fields
+        uint32_t v[3];
+        const char* p = line.data();
+        const char* end = p + line.size();
+        bool ok = true;
+        for (auto& x : v) {
+            auto [next, ec] = std::from_chars(p, end, x);
+            if (ec != std::errc() || (next != end && *next != ',')) {
+                ok = false;
+                break;
+            }
+            p = next == end ? end : next + 1;
         }
+        if (ok)
+            logged_.insert(flip_key(v[0], v[1], v[2]));
     }
+}
 
-    return false;
+bool CampaignLogger::contains(const IterationArgs& args) const
+{
+    if (aggregated_)
+        return false;
+    std::call_once(loggedOnce_, [this] { load_logged(); });
+    return logged_.count(flip_key(args.limb, args.coeff, args.bit)) != 0;
 }
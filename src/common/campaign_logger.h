@@ -10,6 +10,11 @@
 #include <cstdlib>
 #include <iostream>
 #include "utils_ckks.h"
+#include "csv_encoder.h"
+#include "campaign_summary.h"
+#include <memory>
+#include <limits>
+#include <unordered_set>
 
 struct BitflipResult {
     uint32_t limb;
@@ -21,16 +26,37 @@ struct BitflipResult {
     SlotErrorStats stats;
     uint32_t hidden_layer;
     uint32_t reduceSum_layer;
+    // The iteration killed or hung its fork-server worker (no metrics)
+    bool crashed = false;
+    // Complex campaigns: max relative modulus error and max phase error
+    // (radians) over the slots; NaN for real ones
+    double mod_error = std::numeric_limits<double>::quiet_NaN();
+    double phase_error = std::numeric_limits<double>::quiet_NaN();
 
     static std::string header();
+    // Appends the row to out (no allocation once out has grown)
+    void encode(CsvEncoder& out) const;
     std::string row() const;
 };
 
+// --record/--recordCoeff. aggregate keeps a CampaignSummary (per bit, limb
+// and (limb, bit), optionally per coefficient) instead of writing rows, and
+// writes it once to summary_<id>.csv on close(), in the schema of
+// backends/aggregate. Such a campaign cannot be resumed: contains() is
+// always false.
+struct RecordOptions {
+    bool aggregate = false;
+    bool perCoeff = false;
+
+    static RecordOptions from(const CampaignArgs& args);
+};
+
 class CampaignLogger {
 public:
     CampaignLogger(uint32_t campaign_id,
                    const std::string& results_dir,
-                   size_t flush_threshold = 10000);
+                   size_t flush_threshold = 10000,
+                   RecordOptions record = {});
 
     void log(const BitflipResult& r);
     void log(uint32_t limb, uint32_t coeff, uint32_t bit,
@@ -43,16 +69,34 @@ public:
 
     uint64_t total() const { return total_; }
     uint64_t sdc() const { return sdc_; }
+    uint64_t crashed() const { return crashed_; }
     ~CampaignLogger();
+    // Whether the campaign file already has this flip. The file is read
+    // into a hash set on the first call; rows logged after it are not seen.
     bool contains(const IterationArgs& args) const;
 
 private:
-    std::ofstream file_;
+    void write_summary();
+    static uint64_t flip_key(uint32_t limb, uint32_t coeff, uint32_t bit);
+    void load_logged() const;
+
+    uint32_t campaign_id_;
+    std::string dir_;
+    // --record aggregate: summary_ is null once written
+    bool aggregated_ = false;
+    std::unique_ptr<CampaignSummary> summary_;
+    int fd_ = -1;
     std::string csv_path_;
-    std::vector<std::string> buffer_;
+    // Encoded rows not yet written; flushed every flush_threshold_ rows
+    CsvEncoder buffer_;
+    size_t pending_ = 0;
     std::mutex mtx_;
     size_t flush_threshold_;
     uint64_t total_ = 0;
     uint64_t sdc_ = 0;
+    uint64_t crashed_ = 0;
+    // contains(): flip_key of every row in the file
+    mutable std::once_flag loggedOnce_;
+    mutable std::unordered_set<uint64_t> logged_;
 };
 
@@ -1,6 +1,8 @@
 #include "campaign_registry.h"
+#include "csv_encoder.h"
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <sstream>
 #include <fcntl.h>
 #include <unistd.h>
@@ -8,11 +10,14 @@
 #include <chrono>
 #include <stdexcept>
 #include <type_traits>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace {
 
+// Campaign keys keep the ostream formatting (6 significant digits for
+// doubles) that the existing campaigns_start.csv rows were written with
 template <typename... Ts>
 std::string joinCsvFields(const Ts&... fields)
 {
@@ -35,6 +40,166 @@ std::string joinCsvFields(const Ts&... fields)
     return oss.str();
 }
 
+// campaigns_start.csv columns after campaign_id, in key order. Columns added
+// after the first version only hold a value for the campaigns that read them
+// (columnApplies) and are empty otherwise, so older keys still match.
+const std::vector<std::string> kStartColumns = {
+    "library", "stage", "logN", "logQ", "bitPerCoeff", "logDelta", "logSlots",
+    "withNTT", "mult_depth", "doAdd", "doPlainMul", "doMul", "doScalarMul",
+    "doRot", "doBoot", "op_step", "op_depth", "amountBits", "seed", "seed_input",
+    "isComplex", "logMin", "logMax", "isExhaustive", "dnum", "scaleTech",
+    "nnBatch", "nnPacked", "thresholdsSKA", "attackSKA"};
+// Columns of the first version (library..scaleTech), present in every file
+constexpr size_t kFirstColumns = 26;
+
+bool isNNLibrary(const std::string& library)
+{
+    return library == "openfheNN" || library == "heaanNN";
+}
+
+bool columnApplies(const std::string& column, const std::string& library)
+{
+    if (column == "nnBatch" || column == "nnPacked")
+        return isNNLibrary(library);
+    if (column == "thresholdsSKA" || column == "attackSKA")
+        return library == "openfhe-detectors";
+    return true;
+}
+
+// Value of a column missing from an older file, for a row of library
+std::string legacyDefault(const std::string& column, const std::string& library)
+{
+    if (!columnApplies(column, library))
+        return "";
+    if (column == "nnBatch")
+        return "1";
+    if (column == "nnPacked")
+        return "0";
+    return "";
+}
+
+// detectorBench thresholds as parsed, so "3,5" and "3, 5.0" share a key
+std::string thresholdsKey(const CampaignArgs& args)
+{
+    std::ostringstream os;
+    const auto thresholds = parse_double_list(args.thresholdsSKA);
+    for (size_t k = 0; k < thresholds.size(); ++k)
+        os << (k ? ";" : "") << thresholds[k];
+    return os.str();
+}
+
+std::string startHeader()
+{
+    std::string h = "campaign_id";
+    for (const auto& c : kStartColumns)
+        h += "," + c;
+    return h;
+}
+
+// Fields of one CSV line, unquoting as csvEscape quotes
+std::vector<std::string> splitCsvLine(const std::string& line)
+{
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+                fields.back() += line[++i];
+            else if (c == '"')
+                quoted = false;
+            else
+                fields.back() += c;
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else {
+            fields.back() += c;
+        }
+    }
+    return fields;
+}
+
+void stripEol(std::string& line)
+{
+    while (!line.empty() && (line.back() == '\r' || line.back() == '\n'))
+        line.pop_back();
+}
+
+// Rewrites a campaigns_start.csv of an older layout with the current
+// columns, matched by name; the original is kept as <path>.bak. Throws if
+// a current base column is missing or a row does not fit its header.
+void migrateStartCsv(const std::string& path, const std::vector<std::string>& oldColumns)
+{
+    std::vector<int> source(kStartColumns.size(), -1);
+    for (size_t c = 0; c < kStartColumns.size(); ++c) {
+        for (size_t o = 1; o < oldColumns.size(); ++o)
+            if (oldColumns[o] == kStartColumns[c])
+                source[c] = static_cast<int>(o);
+        if (source[c] < 0 && c < kFirstColumns)
+            throw std::runtime_error("CampaignRegistry: " + path + " no tiene la columna " +
+                                     kStartColumns[c] + "; no se puede migrar");
+    }
+
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line); // header
+    std::ostringstream out;
+    out << startHeader() << '\n';
+    size_t lineNo = 1;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        stripEol(line);
+        if (line.empty())
+            continue;
+        const auto fields = splitCsvLine(line);
+        if (fields.size() != oldColumns.size())
+            throw std::runtime_error("CampaignRegistry: " + path + ":" + std::to_string(lineNo) +
+                                     " tiene " + std::to_string(fields.size()) + " campos y la cabecera " +
+                                     std::to_string(oldColumns.size()) + "; no se puede migrar");
+        const std::string& library = fields[source[0]];
+        out << CampaignRegistry::csvEscape(fields[0]);
+        for (size_t c = 0; c < kStartColumns.size(); ++c) {
+            const std::string& column = kStartColumns[c];
+            std::string value;
+            if (columnApplies(column, library))
+                value = source[c] >= 0 ? fields[source[c]] : legacyDefault(column, library);
+            out << ',' << CampaignRegistry::csvEscape(value);
+        }
+        out << '\n';
+    }
+    if (in.bad())
+        throw std::runtime_error("CampaignRegistry: fallo al leer " + path);
+
+    fs::copy_file(path, path + ".bak", fs::copy_options::overwrite_existing);
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::trunc);
+        f << out.str();
+        if (!f)
+            throw std::runtime_error("CampaignRegistry: fallo al escribir " + tmp);
+    }
+    fs::rename(tmp, path);
+    std::cerr << "[INFO] " << path << " migrado a las columnas actuales (copia en "
+              << path << ".bak)\n";
+}
+
+// Appends the encoded rows to path in one write(2) (called under the flock)
+void appendRows(const std::string& path, CsvEncoder& rows)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    if (fd < 0)
+        throw std::runtime_error("CampaignRegistry: no se pudo abrir " + path + " para escritura");
+    try {
+        rows.flushTo(fd, path);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
 } // namespace
 
 CampaignRegistry::FileLock::FileLock(const std::string& path)
@@ -89,7 +254,14 @@ std::string CampaignRegistry::makeCampaignKey(const CampaignArgs& args)
         args.doAdd, args.doPlainMul, args.doMul, args.doScalarMul,
         args.doRot, args.doBoot, args.op_step, args.op_depth, args.amountBits, args.seed,
         args.seed_input, args.isComplex, args.logMin, args.logMax,
-        args.isExhaustive, args.dnum, args.scaleTech);
+        args.isExhaustive, args.dnum, args.scaleTech,
+        columnApplies("nnBatch", args.library) ? std::to_string(args.nnBatch) : std::string(),
+        columnApplies("nnPacked", args.library) ? std::to_string(args.nnPacked) : std::string(),
+        columnApplies("thresholdsSKA", args.library) ? thresholdsKey(args) : std::string(),
+        columnApplies("attackSKA", args.library)
+            ? std::string(args.openfhe_attack_mode ? to_string(*args.openfhe_attack_mode)
+                                                   : "CompleteInjection")
+            : std::string());
 }
 
 void CampaignRegistry::ensureCsvFilesExist()
@@ -99,10 +271,21 @@ void CampaignRegistry::ensureCsvFilesExist()
         if (!f)
             throw std::runtime_error("CampaignRegistry: no se pudo crear " + start_csv_);
 
-        f << "campaign_id,library,stage,logN,logQ,bitPerCoeff,logDelta,logSlots,"
-             "withNTT,mult_depth,doAdd,doPlainMul,doMul,doScalarMul,doRot,doBoot,op_step,"
-             "op_depth,amountBits,seed,seed_input,"
-             "isComplex,logMin,logMax,isExhaustive,dnum,scaleTech\n";
+        f << startHeader() << '\n';
+    } else {
+        // Rows are only appended under the current header: an older layout
+        // is migrated first, anything else is an error
+        std::ifstream f(start_csv_);
+        std::string header;
+        std::getline(f, header);
+        stripEol(header);
+        if (header != startHeader()) {
+            const auto columns = splitCsvLine(header);
+            if (columns.size() < 2 || columns[0] != "campaign_id" || columns[1] != "library")
+                throw std::runtime_error("CampaignRegistry: cabecera inesperada en " + start_csv_ +
+                                         ": " + header);
+            migrateStartCsv(start_csv_, columns);
+        }
     }
 
     if (!fs::exists(end_csv_)) {
@@ -113,6 +296,14 @@ void CampaignRegistry::ensureCsvFilesExist()
         f << "campaign_id,total_bitflips,sdc_count,"
              "duration_seconds,l2_P95,l2_P99,duration\n";
     }
+
+    if (!fs::exists(meta_csv_)) {
+        std::ofstream f(meta_csv_);
+        if (!f)
+            throw std::runtime_error("CampaignRegistry: no se pudo crear " + meta_csv_);
+
+        f << "campaign_id,key,value\n";
+    }
 }
 
 
@@ -131,8 +322,7 @@ CampaignRegistry::ScanResult CampaignRegistry::scanCsv(
 
     while (std::getline(file, line)) {
 
-        while (!line.empty() && (line.back() == '\r' || line.back() == '\n'))
-            line.pop_back();
+        stripEol(line);
 
         if (line.empty())
             continue;
@@ -170,6 +360,7 @@ CampaignRegistry::CampaignRegistry(const CampaignArgs& args)
 
     start_csv_ = results_dir + "/campaigns_start.csv";
     end_csv_   = results_dir + "/campaigns_end.csv";
+    meta_csv_  = results_dir + "/campaigns_meta.csv";
     lockfile_  = results_dir + "/.registry.lock";
 
     FileLock lock(lockfile_);
@@ -188,14 +379,10 @@ CampaignRegistry::CampaignRegistry(const CampaignArgs& args)
     } else {
         campaign_id = scan.max_id + 1;
 
-        std::ofstream f(start_csv_, std::ios::app);
-        if (!f)
-            throw std::runtime_error("CampaignRegistry: no se pudo abrir " + start_csv_ + " para escritura");
-
-        f << campaign_id << "," << key << "\n";
-
-        if (!f)
-            throw std::runtime_error("CampaignRegistry: fallo al escribir en " + start_csv_);
+        // The key is written as scanCsv compares it, not re-encoded
+        CsvEncoder row(256 + key.size());
+        row.add(campaign_id).raw(key).endRow();
+        appendRows(start_csv_, row);
     }
     // ~FileLock() libera el flock aca.
 }
@@ -204,12 +391,18 @@ void CampaignRegistry::register_end(const CampaignEndRecord& r)
 {
     FileLock lock(lockfile_);
 
-    std::ofstream f(end_csv_, std::ios::app);
-    if (!f)
-        throw std::runtime_error("CampaignRegistry: no se pudo abrir " + end_csv_ + " para escritura");
-    f << joinCsvFields(r.campaign_id, r.total_bitflips, r.sdc_count,
-                        r.duration_seconds, r.l2_P95, r.l2_P99, r.duration)
-      << "\n";
-    if (!f)
-        throw std::runtime_error("CampaignRegistry: fallo al escribir en " + end_csv_);
+    CsvEncoder row(256);
+    row.add(r.campaign_id).add(r.total_bitflips).add(r.sdc_count)
+       .add(r.duration_seconds).add(r.l2_P95).add(r.l2_P99).add(r.duration);
+    row.endRow();
+    appendRows(end_csv_, row);
+}
+
+void CampaignRegistry::register_meta(const std::string& key, const std::string& value)
+{
+    FileLock lock(lockfile_);
+
+    CsvEncoder row(256);
+    row.add(campaign_id).add(key).add(value).endRow();
+    appendRows(meta_csv_, row);
 }
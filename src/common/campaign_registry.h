@@ -28,6 +28,9 @@ public:
 
     std::string makeCampaignKey(const CampaignArgs& args);
     void register_end(const CampaignEndRecord& rec);
+    // Execution details that are not part of the campaign key (thread split,
+    // tuning results): one campaign_id,key,value row in campaigns_meta.csv
+    void register_meta(const std::string& key, const std::string& value);
 
     uint32_t campaign_id;
 
@@ -37,6 +40,7 @@ private:
 
     std::string start_csv_;
     std::string end_csv_;
+    std::string meta_csv_;
     std::string lockfile_;
 
     class FileLock {
@@ -0,0 +1,254 @@
+#include "campaign_summary.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Bin of a non-NaN value: 0 below 10^kMinDecade, kBins-1 from 10^kMaxDecade
+size_t bin_of(double v)
+{
+    using H = LogHistogram;
+    static const double lo = std::pow(10.0, H::kMinDecade);
+    static const double hi = std::pow(10.0, H::kMaxDecade);
+    if (!(v >= lo))
+        return 0;
+    if (v >= hi)
+        return H::kBins - 1;
+    const double pos = (std::log10(v) - H::kMinDecade) * H::kBinsPerDecade;
+    return std::min(static_cast<size_t>(pos), H::kBins - 3) + 1;
+}
+
+// log10 of the lower edge of interior bin b
+double lower_edge_log10(size_t b)
+{
+    using H = LogHistogram;
+    return H::kMinDecade + static_cast<double>(b - 1) / H::kBinsPerDecade;
+}
+
+void merge_cells(std::vector<SummaryCell>& into, const std::vector<SummaryCell>& from)
+{
+    if (into.size() < from.size())
+        into.resize(from.size());
+    for (size_t i = 0; i < from.size(); ++i)
+        into[i].merge(from[i]);
+}
+
+} // namespace
+
+void LogHistogram::add(double v)
+{
+    if (std::isnan(v)) {
+        nan++;
+        return;
+    }
+    if (n == 0) {
+        min = max = v;
+    } else {
+        min = std::min(min, v);
+        max = std::max(max, v);
+    }
+    bins[bin_of(v)]++;
+    n++;
+    if (std::isfinite(v)) {
+        sum += v;
+        finite++;
+    }
+}
+
+void LogHistogram::merge(const LogHistogram& other)
+{
+    if (other.n > 0) {
+        if (n == 0) {
+            min = other.min;
+            max = other.max;
+        } else {
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+        }
+    }
+    for (size_t b = 0; b < kBins; ++b)
+        bins[b] += other.bins[b];
+    n += other.n;
+    nan += other.nan;
+    sum += other.sum;
+    finite += other.finite;
+}
+
+double LogHistogram::mean() const
+{
+    return finite ? sum / finite : std::numeric_limits<double>::quiet_NaN();
+}
+
+double LogHistogram::quantile(double q) const
+{
+    if (n == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+    // Rank of the quantile among the n sorted values, 1-based
+    const double rank = std::max(1.0, std::ceil(std::clamp(q, 0.0, 1.0) * n));
+    uint64_t below = 0;
+    for (size_t b = 0; b < kBins; ++b) {
+        if (bins[b] == 0 || below + bins[b] < rank) {
+            below += bins[b];
+            continue;
+        }
+        if (b == 0)
+            return min;
+        if (b == kBins - 1)
+            return max;
+        const double frac = (rank - below - 0.5) / bins[b];
+        const double v = std::pow(10.0, lower_edge_log10(b) + frac / kBinsPerDecade);
+        return std::clamp(v, min, max);
+    }
+    return max;
+}
+
+void SummaryCell::add(double l2Norm, bool isSdc, const SlotErrorStats& stats, bool isCrashed)
+{
+    count++;
+    sdc += isSdc;
+    crashed += isCrashed;
+    slots.correct += stats.correct;
+    slots.degraded += stats.degraded;
+    slots.corrupted += stats.corrupted;
+    slots.failed += stats.failed;
+    // A crashed iteration has no metrics
+    if (!isCrashed)
+        l2.add(l2Norm);
+}
+
+void SummaryCell::merge(const SummaryCell& other)
+{
+    count += other.count;
+    sdc += other.sdc;
+    crashed += other.crashed;
+    slots.correct += other.slots.correct;
+    slots.degraded += other.slots.degraded;
+    slots.corrupted += other.slots.corrupted;
+    slots.failed += other.slots.failed;
+    l2.merge(other.l2);
+}
+
+CampaignSummary::CampaignSummary(bool perCoeff, bool perLimbBit)
+    : perCoeff_(perCoeff), perLimbBit_(perLimbBit)
+{
+}
+
+SummaryCell& CampaignSummary::at(std::vector<SummaryCell>& cells, size_t i)
+{
+    if (cells.size() <= i)
+        cells.resize(i + 1);
+    return cells[i];
+}
+
+void CampaignSummary::add(uint32_t limb, uint32_t coeff, uint32_t bit,
+                          double l2Norm, bool isSdc, const SlotErrorStats& stats, bool isCrashed)
+{
+    total_.add(l2Norm, isSdc, stats, isCrashed);
+    at(bit_, bit).add(l2Norm, isSdc, stats, isCrashed);
+    at(limb_, limb).add(l2Norm, isSdc, stats, isCrashed);
+    if (perCoeff_)
+        at(coeff_, coeff).add(l2Norm, isSdc, stats, isCrashed);
+    if (perLimbBit_) {
+        if (limbBit_.size() <= limb)
+            limbBit_.resize(limb + 1);
+        at(limbBit_[limb], bit).add(l2Norm, isSdc, stats, isCrashed);
+    }
+}
+
+void CampaignSummary::merge(const CampaignSummary& other)
+{
+    total_.merge(other.total_);
+    merge_cells(bit_, other.bit_);
+    merge_cells(limb_, other.limb_);
+    merge_cells(coeff_, other.coeff_);
+    if (limbBit_.size() < other.limbBit_.size())
+        limbBit_.resize(other.limbBit_.size());
+    for (size_t l = 0; l < other.limbBit_.size(); ++l)
+        merge_cells(limbBit_[l], other.limbBit_[l]);
+}
+
+std::string CampaignSummary::header()
+{
+    return "level,limb,coeff,bit,count,sdc,sdc_rate,crashed,"
+           "correct,degraded,corrupted,failed,"
+           "l2_mean,l2_min,l2_p50,l2_p90,l2_p99,l2_max,l2_hist";
+}
+
+namespace {
+
+// Non-empty bins of h as <log10 lower edge>:<count> separated by ';', the
+// bin below 10^kMinDecade as -inf
+std::string encode_bins(const LogHistogram& h)
+{
+    std::string s;
+    char num[32];
+    for (size_t b = 0; b < LogHistogram::kBins; ++b) {
+        if (h.bins[b] == 0)
+            continue;
+        if (!s.empty())
+            s += ';';
+        if (b == 0) {
+            s += "-inf";
+        } else {
+            auto r = std::to_chars(num, num + sizeof num, lower_edge_log10(b));
+            s.append(num, r.ptr);
+        }
+        s += ':';
+        auto r = std::to_chars(num, num + sizeof num, h.bins[b]);
+        s.append(num, r.ptr);
+    }
+    return s;
+}
+
+// limb/coeff/bit < 0: dimension not grouped by (empty field)
+void encode_cell(CsvEncoder& out, const std::string& prefix, const char* level,
+                 int64_t limb, int64_t coeff, int64_t bit, const SummaryCell& c)
+{
+    if (!prefix.empty())
+        out.raw(prefix);
+    out.add(std::string_view(level));
+    for (int64_t dim : {limb, coeff, bit}) {
+        if (dim < 0)
+            out.raw("");
+        else
+            out.add(dim);
+    }
+    out.add(c.count).add(c.sdc).add(static_cast<double>(c.sdc) / c.count).add(c.crashed)
+       .add(c.slots.correct).add(c.slots.degraded).add(c.slots.corrupted).add(c.slots.failed);
+    const bool any = c.l2.count() > 0;
+    if (any) {
+        out.add(c.l2.mean()).add(c.l2.min).add(c.l2.quantile(0.5))
+           .add(c.l2.quantile(0.9)).add(c.l2.quantile(0.99)).add(c.l2.max)
+           .raw(encode_bins(c.l2));
+    } else {
+        for (int i = 0; i < 7; ++i)
+            out.raw("");
+    }
+    out.endRow();
+}
+
+} // namespace
+
+void CampaignSummary::encode(CsvEncoder& out, const std::string& prefix) const
+{
+    if (total_.count == 0)
+        return;
+    encode_cell(out, prefix, "all", -1, -1, -1, total_);
+    for (size_t b = 0; b < bit_.size(); ++b)
+        if (bit_[b].count)
+            encode_cell(out, prefix, "bit", -1, -1, static_cast<int64_t>(b), bit_[b]);
+    for (size_t l = 0; l < limb_.size(); ++l)
+        if (limb_[l].count)
+            encode_cell(out, prefix, "limb", static_cast<int64_t>(l), -1, -1, limb_[l]);
+    for (size_t k = 0; k < coeff_.size(); ++k)
+        if (coeff_[k].count)
+            encode_cell(out, prefix, "coeff", -1, static_cast<int64_t>(k), -1, coeff_[k]);
+    for (size_t l = 0; l < limbBit_.size(); ++l)
+        for (size_t b = 0; b < limbBit_[l].size(); ++b)
+            if (limbBit_[l][b].count)
+                encode_cell(out, prefix, "limb_bit", static_cast<int64_t>(l), -1,
+                            static_cast<int64_t>(b), limbBit_[l][b]);
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "csv_encoder.h"
+#include "utils_ckks.h"
+
+// Histogram of l2 errors over log10 bins: kBinsPerDecade bins per decade in
+// [10^kMinDecade, 10^kMaxDecade), plus one bin below (zeros included) and
+// one above (inf included). NaNs are only counted. Quantiles interpolate
+// log-linearly inside a bin and are clamped to the observed min/max, so
+// they are within a factor 10^(1/kBinsPerDecade) of the exact ones.
+struct LogHistogram {
+    static constexpr int kBinsPerDecade = 4;
+    static constexpr int kMinDecade = -20;
+    static constexpr int kMaxDecade = 12;
+    static constexpr size_t kBins = (kMaxDecade - kMinDecade) * kBinsPerDecade + 2;
+
+    std::array<uint64_t, kBins> bins{};
+    uint64_t n = 0;       // NaNs excluded
+    uint64_t nan = 0;
+    double sum = 0.0;     // finite values only
+    uint64_t finite = 0;
+    double min = 0.0, max = 0.0;
+
+    void add(double v);
+    void merge(const LogHistogram& other);
+    uint64_t count() const { return n; }
+    double mean() const;
+    // q in [0, 1]; NaN when empty
+    double quantile(double q) const;
+};
+
+// Outcome counts of a set of flips (one bit, limb, coefficient...)
+struct SummaryCell {
+    uint64_t count = 0;
+    uint64_t sdc = 0;
+    uint64_t crashed = 0;
+    SlotErrorStats slots;   // slot categories summed over the flips
+    LogHistogram l2;
+
+    void add(double l2Norm, bool isSdc, const SlotErrorStats& stats, bool isCrashed);
+    void merge(const SummaryCell& other);
+};
+
+// Per-bit, per-limb and per-coefficient summaries of one campaign, plus
+// per-(limb, bit) when enabled. Cells are indexed by value and grown on
+// demand; a coefficient cell costs about 1 KB.
+//
+// Rows (header()): level,limb,coeff,bit,count,sdc,sdc_rate,crashed,
+// correct,degraded,corrupted,failed,l2_mean,l2_min,l2_p50,l2_p90,l2_p99,l2_max,
+// l2_hist
+// level is all, bit, limb, coeff or limb_bit; the dimensions a level does not
+// group by are left empty. l2_hist lists the non-empty LogHistogram bins as
+// <log10 of the lower edge>:<count> joined by ';' ("-inf" for the bin below
+// 10^kMinDecade), e.g. "-3.25:17;-3:4".
+class CampaignSummary {
+public:
+    explicit CampaignSummary(bool perCoeff = true, bool perLimbBit = false);
+
+    void add(uint32_t limb, uint32_t coeff, uint32_t bit,
+             double l2Norm, bool isSdc, const SlotErrorStats& stats, bool isCrashed);
+    void merge(const CampaignSummary& other);
+
+    uint64_t total() const { return total_.count; }
+    const std::vector<SummaryCell>& byBit() const { return bit_; }
+
+    static std::string header();
+    // One row per non-empty cell, each preceded by prefix (already encoded
+    // fields, e.g. the campaign id; empty for none)
+    void encode(CsvEncoder& out, const std::string& prefix = "") const;
+
+private:
+    static SummaryCell& at(std::vector<SummaryCell>& cells, size_t i);
+
+    bool perCoeff_;
+    bool perLimbBit_;
+    SummaryCell total_;
+    std::vector<SummaryCell> bit_;
+    std::vector<SummaryCell> limb_;
+    std::vector<SummaryCell> coeff_;
+    std::vector<std::vector<SummaryCell>> limbBit_;   // [limb][bit]
+};
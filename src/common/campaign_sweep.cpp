@@ -0,0 +1,131 @@
+#include "campaign_sweep.h"
+
+#include <getopt.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Columns that do not change the backend context: a group is set up once
+// and each of its rows only changes these.
+bool isPerRowColumn(const std::string& col)
+{
+    return col == "stage" || col == "op_step" || col == "op_depth";
+}
+
+std::vector<std::string> splitCsvLine(const std::string& line)
+{
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                field += '"';
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+} // namespace
+
+std::vector<SweepGroup> load_sweep_groups(const std::string& csvPath,
+                                          const std::string& library,
+                                          const std::string& binary)
+{
+    std::ifstream file(csvPath);
+    if (!file.is_open())
+        throw std::runtime_error("load_sweep_groups: no se pudo abrir " + csvPath);
+
+    std::string line;
+    if (!std::getline(file, line))
+        throw std::runtime_error("load_sweep_groups: config vacio " + csvPath);
+    while (!line.empty() && line.back() == '\r') line.pop_back();
+    const std::vector<std::string> header = splitCsvLine(line);
+
+    std::vector<SweepGroup> groups;
+    std::map<std::string, size_t> groupIndex;
+
+    while (std::getline(file, line)) {
+        while (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty())
+            continue;
+
+        const auto fields = splitCsvLine(line);
+        if (fields.size() != header.size()) {
+            std::cerr << "Sweep: fila con " << fields.size() << " columnas (esperadas "
+                      << header.size() << "), se ignora\n";
+            continue;
+        }
+
+        SweepRow row;
+        std::ostringstream key;
+        for (size_t i = 0; i < header.size(); ++i) {
+            const std::string& col = header[i];
+            const std::string& val = fields[i];
+            if (col == "run_id")  { row.run_id = val;  continue; }
+            if (col == "binary")  { row.binary = val;  continue; }
+            if (col == "library") { row.library = val; continue; }
+            if (val.empty())
+                continue;
+            row.params.emplace_back(col, val);
+            if (!isPerRowColumn(col))
+                key << col << '=' << val << ';';
+        }
+
+        if (row.library != library || row.binary != binary) {
+            std::cerr << "Sweep: " << row.run_id << " (" << row.library << "/"
+                      << row.binary << ") no es " << library << "/" << binary
+                      << ", se ignora\n";
+            continue;
+        }
+
+        const std::string k = key.str();
+        auto it = groupIndex.find(k);
+        if (it == groupIndex.end()) {
+            it = groupIndex.emplace(k, groups.size()).first;
+            groups.push_back({k, {}});
+        }
+        groups[it->second].rows.push_back(std::move(row));
+    }
+    return groups;
+}
+
+CampaignArgs sweep_row_args(const SweepRow& row, const char* program_name)
+{
+    std::vector<std::string> storage;
+    storage.reserve(1 + 2 * row.params.size());
+    storage.emplace_back(program_name);
+    for (const auto& [col, val] : row.params) {
+        storage.push_back("--" + col);
+        storage.push_back(val);
+    }
+
+    std::vector<char*> argv;
+    argv.reserve(storage.size() + 1);
+    for (auto& s : storage)
+        argv.push_back(s.data());
+    argv.push_back(nullptr);
+
+    // getopt keeps global state between calls; 0 forces a full reinit.
+    optind = 0;
+    return parse_arguments(static_cast<int>(storage.size()), argv.data());
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include "campaign_helper.h"
+
+// One row of a run_campaign.py config CSV.
+struct SweepRow {
+    std::string run_id;
+    std::string binary;
+    std::string library;
+    // column -> value, empty values already dropped (same as run_campaign.py)
+    std::vector<std::pair<std::string, std::string>> params;
+};
+
+// Rows that only differ in stage/op_step/op_depth share one setup_campaign.
+struct SweepGroup {
+    std::string key;
+    std::vector<SweepRow> rows;
+};
+
+// Reads a config CSV and groups the rows for `library` whose binary is
+// `binary`. Other rows are reported on stderr and skipped.
+std::vector<SweepGroup> load_sweep_groups(const std::string& csvPath,
+                                          const std::string& library,
+                                          const std::string& binary);
+
+// Builds the CampaignArgs of a row through parse_arguments, as if the row
+// had been launched as "<program> --col value ...".
+CampaignArgs sweep_row_args(const SweepRow& row, const char* program_name);
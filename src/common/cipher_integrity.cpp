@@ -0,0 +1,112 @@
+#include "cipher_integrity.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// In-place transpose of a 64x64 bit matrix (row i = word i, column j = bit
+// j): afterwards bit i of m[j] is bit j of the original m[i]. Recursive
+// block swap, log2(64) rounds of 32 word pairs.
+void transpose64(uint64_t m[64])
+{
+    uint64_t mask = 0x00000000FFFFFFFFULL;
+    for (uint32_t j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+        for (uint32_t k = 0; k < 64; k = (k + j + 1) & ~j) {
+            uint64_t t = ((m[k] >> j) ^ m[k + j]) & mask;
+            m[k] ^= t << j;
+            m[k + j] ^= t;
+        }
+    }
+}
+
+} // namespace
+
+void IntegrityStats::merge(const IntegrityStats& other)
+{
+    residues += other.residues;
+    outOfRange += other.outOfRange;
+    chi2 += other.chi2;
+    dof += other.dof;
+    worstDeviation = std::max(worstDeviation, other.worstDeviation);
+}
+
+double IntegrityStats::pValue() const
+{
+    if (dof == 0)
+        return 1.0;
+    // Wilson-Hilferty: (chi2/k)^(1/3) is close to normal with mean
+    // 1 - 2/(9k) and variance 2/(9k)
+    const double k = dof;
+    const double v = 2.0 / (9.0 * k);
+    const double z = (std::cbrt(chi2 / k) - (1.0 - v)) / std::sqrt(v);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+uint64_t count_out_of_range(const uint64_t* a, size_t n, uint64_t q)
+{
+    // Branchless so the compiler can vectorize it
+    uint64_t bad = 0;
+    for (size_t i = 0; i < n; ++i)
+        bad += a[i] >= q;
+    return bad;
+}
+
+void count_bit_ones(const uint64_t* a, size_t n, uint64_t* ones)
+{
+    uint64_t block[64];
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::copy(a + i, a + i + 64, block);
+        transpose64(block);
+        for (uint32_t b = 0; b < 64; ++b)
+            ones[b] += static_cast<uint64_t>(__builtin_popcountll(block[b]));
+    }
+    for (; i < n; ++i)
+        for (uint32_t b = 0; b < 64; ++b)
+            ones[b] += (a[i] >> b) & 1;
+}
+
+double bit_probability(uint64_t q, uint32_t b)
+{
+    // Full periods of 2^(b+1) contribute 2^b each, the partial one whatever
+    // exceeds 2^b
+    const unsigned __int128 period = static_cast<unsigned __int128>(1) << (b + 1);
+    const unsigned __int128 half = static_cast<unsigned __int128>(1) << b;
+    const unsigned __int128 full = (q / period) * half;
+    const unsigned __int128 rest = q % period;
+    const unsigned __int128 partial = rest > half ? rest - half : 0;
+    return static_cast<double>(full + partial) / static_cast<double>(q);
+}
+
+IntegrityStats check_limb(const uint64_t* a, size_t n, uint64_t q)
+{
+    IntegrityStats s;
+    s.residues = n;
+    if (n == 0 || q < 2)
+        return s;
+    s.outOfRange = count_out_of_range(a, n, q);
+
+    uint64_t ones[64] = {};
+    count_bit_ones(a, n, ones);
+
+    const uint32_t bits = 64 - static_cast<uint32_t>(__builtin_clzll(q - 1));
+    for (uint32_t b = 0; b < bits; ++b) {
+        const double p = bit_probability(q, b);
+        const double var = n * p * (1.0 - p);
+        if (var <= 0.0)
+            continue;
+        const double dev = ones[b] - n * p;
+        s.chi2 += dev * dev / var;
+        s.dof++;
+        s.worstDeviation = std::max(s.worstDeviation, std::abs(dev) / n);
+    }
+    return s;
+}
+
+bool integrity_suspect(const IntegrityStats& stats, double alpha)
+{
+    if (stats.outOfRange > 0)
+        return true;
+    return alpha > 0.0 && stats.pValue() < alpha;
+}
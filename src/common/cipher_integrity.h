@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ciphertext-side fault detectors that work on one RNS limb at a time, as
+// raw residues (uint64 words) in any format: c0 and c1 are uniform mod q_i
+// in coefficient and in NTT form alike, so no CRT interpolation is needed.
+//
+// - Range: a residue >= q_i cannot come out of any CKKS operation.
+// - Bit uniformity: for each bit position b the number of residues with
+//   bit b set is compared against its exact expectation n * p_b, where p_b
+//   is the fraction of [0, q_i) with bit b set (not 1/2 for the top bits).
+//   Counts are taken 64 residues at a time: the 64x64 bit matrix is
+//   transposed so that each word holds one bit position, then popcounted.
+struct IntegrityStats {
+    uint64_t residues = 0;
+    uint64_t outOfRange = 0;       // residues >= q_i
+    double chi2 = 0.0;             // sum over bit positions of z_b^2
+    uint32_t dof = 0;              // bit positions in chi2
+    double worstDeviation = 0.0;   // max_b |ones_b / n - p_b|
+
+    void merge(const IntegrityStats& other);
+    // Upper tail probability of chi2 (Wilson-Hilferty), 1 when dof = 0
+    double pValue() const;
+};
+
+// Residues of a[0..n) that are >= q
+uint64_t count_out_of_range(const uint64_t* a, size_t n, uint64_t q);
+
+// ones[b] += residues of a[0..n) with bit b set, b < 64 (ones has 64 entries)
+void count_bit_ones(const uint64_t* a, size_t n, uint64_t* ones);
+
+// P(bit b set) for x uniform in [0, q)
+double bit_probability(uint64_t q, uint32_t b);
+
+// Range and bit-uniformity statistics of one limb
+IntegrityStats check_limb(const uint64_t* a, size_t n, uint64_t q);
+
+// Decision of the integrity detector: any residue out of range, or bit
+// counts with p-value below alpha (alpha <= 0 disables the statistical part)
+bool integrity_suspect(const IntegrityStats& stats, double alpha);
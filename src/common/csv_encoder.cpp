@@ -0,0 +1,39 @@
+#include "csv_encoder.h"
+
+#include <cerrno>
+#include <stdexcept>
+
+#include <unistd.h>
+
+void CsvEncoder::escaped(std::string_view s)
+{
+    // Same rule as CampaignRegistry::csvEscape
+    if (s.find_first_of(",\"\n\r") == std::string_view::npos) {
+        append(s);
+        return;
+    }
+    ensure(s.size() * 2 + 2);
+    buf_[len_++] = '"';
+    for (char c : s) {
+        if (c == '"')
+            buf_[len_++] = '"';
+        buf_[len_++] = c;
+    }
+    buf_[len_++] = '"';
+}
+
+void CsvEncoder::flushTo(int fd, const std::string& path)
+{
+    size_t done = 0;
+    while (done < len_) {
+        ssize_t n = ::write(fd, buf_.data() + done, len_ - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("CsvEncoder: fallo al escribir en " + path +
+                                     " (errno=" + std::to_string(errno) + ")");
+        }
+        done += static_cast<size_t>(n);
+    }
+    clear();
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// CSV rows formatted straight into one reusable byte buffer: integers and
+// doubles go through std::to_chars (doubles in shortest round-trip form, so
+// parsing the field gives back the same double), strings are quoted only
+// when they need it. Once the buffer has grown to a flush worth of rows,
+// encoding allocates nothing. flushTo() hands the bytes to write(2).
+//
+// Separators are implicit: add() writes ',' before every field but the
+// first of a row, endRow() closes it.
+class CsvEncoder {
+public:
+    explicit CsvEncoder(size_t capacity = 1 << 20) { buf_.resize(capacity); }
+
+    template <typename T>
+    CsvEncoder& add(const T& value)
+    {
+        separator();
+        using V = std::decay_t<T>;
+        if constexpr (std::is_same_v<V, bool>) {
+            ensure(1);
+            buf_[len_++] = value ? '1' : '0';
+        } else if constexpr (std::is_integral_v<V> || std::is_floating_point_v<V>) {
+            // 20 digits + sign for integers, at most 24 for a shortest double
+            ensure(32);
+            auto res = std::to_chars(buf_.data() + len_, buf_.data() + buf_.size(), value);
+            len_ = static_cast<size_t>(res.ptr - buf_.data());
+        } else {
+            escaped(std::string_view(value));
+        }
+        return *this;
+    }
+
+    // Bytes appended as they are: an already encoded run of fields
+    CsvEncoder& raw(std::string_view s)
+    {
+        separator();
+        append(s);
+        return *this;
+    }
+
+    void endRow()
+    {
+        ensure(1);
+        buf_[len_++] = '\n';
+        rowStart_ = true;
+    }
+
+    const char* data() const { return buf_.data(); }
+    size_t size() const { return len_; }
+    bool empty() const { return len_ == 0; }
+    void clear() { len_ = 0; rowStart_ = true; }
+
+    // Writes the whole buffer to fd (short writes and EINTR are retried),
+    // then clears it. Throws std::runtime_error on a write error.
+    void flushTo(int fd, const std::string& path);
+
+private:
+    void separator()
+    {
+        if (!rowStart_) {
+            ensure(1);
+            buf_[len_++] = ',';
+        }
+        rowStart_ = false;
+    }
+
+    void ensure(size_t n)
+    {
+        if (buf_.size() - len_ < n)
+            buf_.resize(std::max(buf_.size() * 2, len_ + n));
+    }
+
+    void append(std::string_view s)
+    {
+        ensure(s.size());
+        s.copy(buf_.data() + len_, s.size());
+        len_ += s.size();
+    }
+
+    void escaped(std::string_view s);
+
+    std::vector<char> buf_;
+    size_t len_ = 0;
+    bool rowStart_ = true;
+};
@@ -0,0 +1,76 @@
+#include "detector_bench.h"
+#include "campaign_registry.h"
+
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+void DetectorTally::add(bool fired, bool corrupted, int64_t elapsedNs)
+{
+    if (corrupted)
+        (fired ? tp : fn)++;
+    else
+        (fired ? fp : tn)++;
+    ns += elapsedNs;
+}
+
+double DetectorTally::tpr() const
+{
+    return tp + fn ? static_cast<double>(tp) / (tp + fn) : 0.0;
+}
+
+double DetectorTally::fpr() const
+{
+    return fp + tn ? static_cast<double>(fp) / (fp + tn) : 0.0;
+}
+
+double DetectorTally::meanUs() const
+{
+    return total() ? static_cast<double>(ns) / 1e3 / total() : 0.0;
+}
+
+size_t DetectorBench::add(const std::string& name)
+{
+    tallies_.push_back(DetectorTally{});
+    tallies_.back().name = name;
+    return tallies_.size() - 1;
+}
+
+void DetectorBench::record(size_t detector, bool fired, bool corrupted, int64_t elapsedNs)
+{
+    if (detector >= tallies_.size())
+        throw std::out_of_range("DetectorBench: detector " + std::to_string(detector) + " no registrado");
+    tallies_[detector].add(fired, corrupted, elapsedNs);
+}
+
+void DetectorBench::writeCsv(const std::string& path, uint32_t campaign_id) const
+{
+    std::ofstream f(path, std::ios::trunc);
+    if (!f)
+        throw std::runtime_error("DetectorBench: no se pudo abrir " + path);
+    f << "campaign_id,detector,tp,fp,tn,fn,tpr,fpr,mean_us\n";
+    for (const auto& t : tallies_) {
+        f << campaign_id << ',' << CampaignRegistry::csvEscape(t.name) << ','
+          << t.tp << ',' << t.fp << ',' << t.tn << ',' << t.fn << ','
+          << t.tpr() << ',' << t.fpr() << ',' << t.meanUs() << '\n';
+    }
+    if (!f)
+        throw std::runtime_error("DetectorBench: fallo al escribir " + path);
+}
+
+void DetectorBench::print(std::ostream& os) const
+{
+    os << std::left << std::setw(24) << "detector"
+       << std::right << std::setw(8) << "TP" << std::setw(8) << "FP"
+       << std::setw(8) << "TN" << std::setw(8) << "FN"
+       << std::setw(10) << "TPR" << std::setw(10) << "FPR"
+       << std::setw(12) << "mean_us" << '\n';
+    for (const auto& t : tallies_) {
+        os << std::left << std::setw(24) << t.name
+           << std::right << std::setw(8) << t.tp << std::setw(8) << t.fp
+           << std::setw(8) << t.tn << std::setw(8) << t.fn
+           << std::setw(10) << std::setprecision(4) << t.tpr()
+           << std::setw(10) << t.fpr()
+           << std::setw(12) << t.meanUs() << '\n';
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Confusion matrix and overhead of one detector over a campaign. Positive
+// means the fault corrupted the output (it fails AcceptCKKSResult against
+// the clean result); a detector that fires on a benign flip is a false
+// positive.
+struct DetectorTally {
+    std::string name;
+    uint64_t tp = 0, fp = 0, tn = 0, fn = 0;
+    // Time the detector adds to the pipeline (for a check inside Decrypt,
+    // its Decrypt minus a plain one); timing noise can make a sample < 0
+    int64_t ns = 0;
+
+    void add(bool fired, bool corrupted, int64_t elapsedNs);
+    uint64_t total() const { return tp + fp + tn + fn; }
+    double tpr() const;    // detected / corrupted
+    double fpr() const;    // fired / benign
+    double meanUs() const;
+};
+
+// Several detectors judged on the same faulty results
+class DetectorBench {
+public:
+    // Returns the index to record under
+    size_t add(const std::string& name);
+    void record(size_t detector, bool fired, bool corrupted, int64_t elapsedNs);
+
+    const std::vector<DetectorTally>& tallies() const { return tallies_; }
+
+    // One row per detector:
+    // campaign_id,detector,tp,fp,tn,fn,tpr,fpr,mean_us
+    void writeCsv(const std::string& path, uint32_t campaign_id) const;
+    void print(std::ostream& os = std::cout) const;
+
+private:
+    std::vector<DetectorTally> tallies_;
+};
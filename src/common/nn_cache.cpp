@@ -0,0 +1,321 @@
+#include "nn_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'N', 'N', 'C', 'A', 'C', 'H', 'E', '1'};
+
+uint64_t align8(uint64_t v) { return (v + 7) & ~uint64_t(7); }
+
+// Comma separated doubles of one line, parsed in place with strtod
+void parseDoubles(const std::string& line, std::vector<double>& out, size_t max)
+{
+    const char* p = line.c_str();
+    while (*p && out.size() < max) {
+        char* end = nullptr;
+        double v = std::strtod(p, &end);
+        if (end == p)
+            throw std::runtime_error("NNCache: valor no numerico en '" + line.substr(0, 40) + "'");
+        out.push_back(v);
+        p = end;
+        while (*p == ',' || *p == ' ' || *p == '\r') ++p;
+    }
+}
+
+std::vector<double> readCsvValues(const std::string& path, size_t count, size_t perLine)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("No se pudo abrir " + path);
+
+    std::vector<double> values;
+    values.reserve(count);
+    std::string line;
+    std::vector<double> rowVals;
+    while (values.size() < count && std::getline(file, line)) {
+        rowVals.clear();
+        parseDoubles(line, rowVals, perLine);
+        values.insert(values.end(), rowVals.begin(), rowVals.end());
+    }
+    if (values.size() != count)
+        throw std::runtime_error("NNCache: " + path + " tiene " + std::to_string(values.size()) +
+                                 " valores (esperado: " + std::to_string(count) + ")");
+    return values;
+}
+
+void writeOrThrow(FILE* f, const void* data, size_t size, const std::string& path)
+{
+    if (size > 0 && std::fwrite(data, 1, size, f) != size)
+        throw std::runtime_error("NNCache: fallo al escribir " + path);
+}
+
+void padTo8(FILE* f, uint64_t& offset, const std::string& path)
+{
+    static const char zeros[8] = {};
+    uint64_t aligned = align8(offset);
+    writeOrThrow(f, zeros, aligned - offset, path);
+    offset = aligned;
+}
+
+} // namespace
+
+NNCache::NNCache(const std::string& path) : path_(path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("NNCache: no se pudo abrir " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(NNCacheHeader)) {
+        ::close(fd);
+        throw std::runtime_error("NNCache: " + path + " no es un cache valido");
+    }
+    size_ = static_cast<size_t>(st.st_size);
+
+    void* mem = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED)
+        throw std::runtime_error("NNCache: mmap fallo para " + path + " (errno=" + std::to_string(errno) + ")");
+
+    base_ = static_cast<const uint8_t*>(mem);
+    header_ = reinterpret_cast<const NNCacheHeader*>(base_);
+
+    const uint64_t pixelsEnd = header_->pixelsOffset + header_->rows * header_->input * sizeof(double);
+    if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0 ||
+        pixelsEnd > size_ || header_->blobsOffset > size_) {
+        munmap(mem, size_);
+        throw std::runtime_error("NNCache: " + path + " no es un cache valido");
+    }
+}
+
+NNCache::~NNCache()
+{
+    if (base_)
+        munmap(const_cast<uint8_t*>(base_), size_);
+}
+
+std::unique_ptr<NNCache> NNCache::openIfExists(const std::string& path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return nullptr;
+    return std::make_unique<NNCache>(path);
+}
+
+const double* NNCache::doubles(uint64_t offset) const
+{
+    return reinterpret_cast<const double*>(base_ + offset);
+}
+
+const double* NNCache::pixels(size_t index) const
+{
+    return doubles(header_->pixelsOffset) + index * header_->input;
+}
+
+bool NNCache::row(size_t index, size_t& label, std::vector<double>& pixelsOut) const
+{
+    if (index >= header_->rows) {
+        std::cerr << "Error: índice " << index
+                  << " fuera de rango (total filas: " << header_->rows << ")\n";
+        return false;
+    }
+    const uint64_t* labels = reinterpret_cast<const uint64_t*>(base_ + header_->labelsOffset);
+    label = static_cast<size_t>(labels[index]);
+    const double* p = pixels(index);
+    pixelsOut.assign(p, p + header_->input);
+    return true;
+}
+
+std::vector<std::vector<double>> NNCache::W1() const
+{
+    const double* p = doubles(header_->W1Offset);
+    std::vector<std::vector<double>> m(header_->hidden);
+    for (size_t j = 0; j < header_->hidden; ++j)
+        m[j].assign(p + j * header_->input, p + (j + 1) * header_->input);
+    return m;
+}
+
+std::vector<double> NNCache::b1() const
+{
+    const double* p = doubles(header_->b1Offset);
+    return std::vector<double>(p, p + header_->hidden);
+}
+
+std::vector<std::vector<double>> NNCache::W2() const
+{
+    const double* p = doubles(header_->W2Offset);
+    std::vector<std::vector<double>> m(header_->output);
+    for (size_t o = 0; o < header_->output; ++o)
+        m[o].assign(p + o * header_->hidden, p + (o + 1) * header_->hidden);
+    return m;
+}
+
+std::vector<double> NNCache::b2() const
+{
+    const double* p = doubles(header_->b2Offset);
+    return std::vector<double>(p, p + header_->output);
+}
+
+bool NNCache::findBlob(const std::string& tag, const uint8_t*& data, size_t& size) const
+{
+    uint64_t off = header_->blobsOffset;
+    while (off + sizeof(uint32_t) <= size_) {
+        uint32_t tagLen;
+        std::memcpy(&tagLen, base_ + off, sizeof(tagLen));
+        uint64_t sizeOff = off + sizeof(uint32_t) + tagLen;
+        if (sizeOff + sizeof(uint64_t) > size_)
+            break;
+        uint64_t blobSize;
+        std::memcpy(&blobSize, base_ + sizeOff, sizeof(blobSize));
+        uint64_t dataOff = sizeOff + sizeof(uint64_t);
+        if (dataOff + blobSize > size_)
+            break; // truncated append
+        if (tagLen == tag.size() &&
+            std::memcmp(base_ + off + sizeof(uint32_t), tag.data(), tagLen) == 0) {
+            data = base_ + dataOff;
+            size = static_cast<size_t>(blobSize);
+            return true;
+        }
+        off = align8(dataOff + blobSize);
+    }
+    return false;
+}
+
+void NNCache::appendBlob(const std::string& path, const std::string& tag,
+                         const std::vector<uint8_t>& data)
+{
+    // One buffer and one O_APPEND write, so concurrent campaigns appending
+    // the same tag at worst store it twice
+    const uint32_t tagLen = static_cast<uint32_t>(tag.size());
+    const uint64_t blobSize = data.size();
+    std::vector<uint8_t> rec(sizeof(tagLen) + tagLen + sizeof(blobSize) + blobSize);
+    uint8_t* p = rec.data();
+    std::memcpy(p, &tagLen, sizeof(tagLen));        p += sizeof(tagLen);
+    std::memcpy(p, tag.data(), tagLen);             p += tagLen;
+    std::memcpy(p, &blobSize, sizeof(blobSize));    p += sizeof(blobSize);
+    if (blobSize) std::memcpy(p, data.data(), blobSize);
+    rec.resize(align8(rec.size()), 0);
+
+    int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0)
+        throw std::runtime_error("NNCache: no se pudo abrir " + path + " para escritura");
+    ssize_t n = ::write(fd, rec.data(), rec.size());
+    ::close(fd);
+    if (n != static_cast<ssize_t>(rec.size()))
+        throw std::runtime_error("NNCache: fallo al escribir en " + path);
+}
+
+size_t writeNNCacheFromCSV(const std::string& outPath,
+                           const std::string& mnistCsv,
+                           const std::string& W1Csv, const std::string& b1Csv,
+                           const std::string& W2Csv, const std::string& b2Csv,
+                           size_t input, size_t hidden, size_t output)
+{
+    auto W1 = readCsvValues(W1Csv, hidden * input, input);
+    auto b1 = readCsvValues(b1Csv, hidden, hidden);
+    auto W2 = readCsvValues(W2Csv, output * hidden, hidden);
+    auto b2 = readCsvValues(b2Csv, output, output);
+
+    std::ifstream mnist(mnistCsv);
+    if (!mnist.is_open())
+        throw std::runtime_error("No se pudo abrir " + mnistCsv);
+
+    const std::string tmpPath = outPath + ".tmp";
+    FILE* f = std::fopen(tmpPath.c_str(), "wb");
+    if (!f)
+        throw std::runtime_error("NNCache: no se pudo crear " + tmpPath);
+
+    try {
+        NNCacheHeader h{};
+        std::memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.input = input;
+        h.hidden = hidden;
+        h.output = output;
+        writeOrThrow(f, &h, sizeof(h), tmpPath); // patched at the end
+
+        uint64_t offset = sizeof(h);
+        padTo8(f, offset, tmpPath);
+        h.pixelsOffset = offset;
+
+        // Same normalization as loadMnistNormRowByIndex: 2*(x/255) - 1
+        constexpr double inv255 = 1.0 / 255.0;
+        std::vector<uint64_t> labels;
+        std::vector<double> pixels;
+        std::string line;
+        while (std::getline(mnist, line)) {
+            if (line.empty() || line == "\r")
+                continue;
+            const char* p = line.c_str();
+            char* end = nullptr;
+            long label = std::strtol(p, &end, 10);
+            if (end == p)
+                throw std::runtime_error("NNCache: fila " + std::to_string(labels.size()) + " sin etiqueta");
+            p = end;
+
+            pixels.clear();
+            while (*p == ',') {
+                ++p;
+                long pixel = std::strtol(p, &end, 10);
+                p = end;
+                pixel = std::clamp(pixel, 0L, 255L);
+                double x = static_cast<double>(pixel) * inv255;
+                pixels.push_back(2.0 * x - 1.0);
+            }
+            if (pixels.size() != input)
+                throw std::runtime_error("NNCache: fila " + std::to_string(labels.size()) + " tiene " +
+                                         std::to_string(pixels.size()) + " píxeles (esperado: " +
+                                         std::to_string(input) + ")");
+
+            writeOrThrow(f, pixels.data(), input * sizeof(double), tmpPath);
+            labels.push_back(static_cast<uint64_t>(label));
+        }
+        h.rows = labels.size();
+        offset += h.rows * input * sizeof(double);
+
+        h.labelsOffset = offset;
+        writeOrThrow(f, labels.data(), labels.size() * sizeof(uint64_t), tmpPath);
+        offset += labels.size() * sizeof(uint64_t);
+
+        auto section = [&](const std::vector<double>& v) {
+            uint64_t at = offset;
+            writeOrThrow(f, v.data(), v.size() * sizeof(double), tmpPath);
+            offset += v.size() * sizeof(double);
+            return at;
+        };
+        h.W1Offset = section(W1);
+        h.b1Offset = section(b1);
+        h.W2Offset = section(W2);
+        h.b2Offset = section(b2);
+        h.blobsOffset = offset;
+
+        if (std::fseek(f, 0, SEEK_SET) != 0)
+            throw std::runtime_error("NNCache: fallo al escribir " + tmpPath);
+        writeOrThrow(f, &h, sizeof(h), tmpPath);
+        if (std::fclose(f) != 0) {
+            f = nullptr;
+            throw std::runtime_error("NNCache: fallo al escribir " + tmpPath);
+        }
+        f = nullptr;
+
+        if (std::rename(tmpPath.c_str(), outPath.c_str()) != 0)
+            throw std::runtime_error("NNCache: no se pudo renombrar " + tmpPath + " a " + outPath);
+        return h.rows;
+    } catch (...) {
+        if (f) std::fclose(f);
+        std::remove(tmpPath.c_str());
+        throw;
+    }
+}
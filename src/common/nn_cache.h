@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Binary cache of the MNIST network data, built once by nnCacheConvert.
+//
+// Layout (little endian, every section 8-byte aligned):
+//   NNCacheHeader
+//   pixels  rows * input doubles, already normalized to [-1, 1]
+//   labels  rows uint64
+//   W1      hidden * input doubles,  b1 hidden doubles
+//   W2      output * hidden doubles, b2 output doubles
+//   blobs   {uint32 tagLen, tag, uint64 size, size bytes, pad to 8}*
+//
+// The file is mapped read-only, so a row is one pointer computation.
+// Blobs hold backend data derived from the weights (e.g. pre-encoded HEAAN
+// polynomials) and are appended by whoever computes them first.
+struct NNCacheHeader {
+    char magic[8];          // "NNCACHE1"
+    uint64_t rows;
+    uint64_t input;
+    uint64_t hidden;
+    uint64_t output;
+    uint64_t pixelsOffset;
+    uint64_t labelsOffset;
+    uint64_t W1Offset;
+    uint64_t b1Offset;
+    uint64_t W2Offset;
+    uint64_t b2Offset;
+    uint64_t blobsOffset;
+};
+
+// Default cache file inside the NN data directory
+constexpr const char* NN_CACHE_FILE = "mnist.nncache";
+
+class NNCache {
+public:
+    // Maps path read-only; throws std::runtime_error if it is not a cache
+    explicit NNCache(const std::string& path);
+    ~NNCache();
+
+    NNCache(const NNCache&) = delete;
+    NNCache& operator=(const NNCache&) = delete;
+
+    // nullptr when path does not exist
+    static std::unique_ptr<NNCache> openIfExists(const std::string& path);
+
+    size_t rows() const   { return header_->rows; }
+    size_t input() const  { return header_->input; }
+    size_t hidden() const { return header_->hidden; }
+    size_t output() const { return header_->output; }
+    const std::string& path() const { return path_; }
+
+    // Same contract as loadMnistNormRowByIndex
+    bool row(size_t index, size_t& label, std::vector<double>& pixels) const;
+    const double* pixels(size_t index) const;
+
+    std::vector<std::vector<double>> W1() const;
+    std::vector<double> b1() const;
+    std::vector<std::vector<double>> W2() const;
+    std::vector<double> b2() const;
+
+    // Blob stored under tag at open time
+    bool findBlob(const std::string& tag, const uint8_t*& data, size_t& size) const;
+    // Appends a blob to the file (not visible to already open NNCache objects)
+    static void appendBlob(const std::string& path, const std::string& tag,
+                           const std::vector<uint8_t>& data);
+
+private:
+    const double* doubles(uint64_t offset) const;
+
+    std::string path_;
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    const NNCacheHeader* header_ = nullptr;
+};
+
+// Converts mnist CSV (label + 784 pixels per row) and the weight CSVs into
+// a cache at outPath. Returns the number of rows written.
+size_t writeNNCacheFromCSV(const std::string& outPath,
+                           const std::string& mnistCsv,
+                           const std::string& W1Csv, const std::string& b1Csv,
+                           const std::string& W2Csv, const std::string& b2Csv,
+                           size_t input, size_t hidden, size_t output);
@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+// Packed layout of the MNIST MLP, shared by heaanNN and openfheNN.
+//
+// The input x sits in slots [0, n) of a block of n = 2^logSlots slots and
+// every rotation is cyclic in n. Hidden layer (m neurons, m | n) with the
+// hybrid diagonal method and baby-step/giant-step (n = n1 * n2 diagonals):
+//
+//   z = sum_g rot( sum_b D[g*n1+b] * rot(x, b), g*n1 )
+//   D[g*n1+b][i] = W1[(i - g*n1) mod m][(i + b) mod n]
+//
+// Summing z with its rotations by m, 2m, .., n/2 leaves h[i mod m] in
+// every slot i. Layer 2 multiplies by L2[o*m+j] = W2[o][j] and sums blocks
+// of m slots (rotations 1, 2, .., m/2): logit o ends up in slot o*m.
+struct PackedMLPLayout {
+    size_t n;      // slots of one block
+    size_t m;      // hidden neurons
+    size_t out;    // outputs, logit o at slot o*m
+    size_t n1;     // baby steps
+    size_t n2;     // giant steps
+    size_t logM;
+    size_t strideLevels; // log2(n/m)
+};
+
+inline size_t packedLog2(size_t v)
+{
+    size_t l = 0;
+    while ((size_t(1) << l) < v) l++;
+    return l;
+}
+
+inline PackedMLPLayout packedLayout(size_t n, size_t hidden, size_t output)
+{
+    if (hidden == 0 || (hidden & (hidden - 1)) != 0)
+        throw std::invalid_argument("packedLayout: HIDDEN debe ser potencia de 2");
+    if ((n & (n - 1)) != 0 || n < hidden * output)
+        throw std::invalid_argument("packedLayout: se necesitan al menos HIDDEN*OUTPUT slots");
+
+    PackedMLPLayout l;
+    l.n = n;
+    l.m = hidden;
+    l.out = output;
+    l.logM = packedLog2(hidden);
+    l.n1 = size_t(1) << ((l.logM + 1) / 2);
+    l.n2 = hidden / l.n1;
+    l.strideLevels = packedLog2(n / hidden);
+    return l;
+}
+
+// Diagonals in giant-major order (index g*n1 + b), each of n slots.
+inline std::vector<std::vector<double>> packedDiagonals(
+    const PackedMLPLayout& l, const std::vector<std::vector<double>>& W1)
+{
+    std::vector<std::vector<double>> diags(l.m, std::vector<double>(l.n, 0.0));
+    const size_t input = W1[0].size();
+    if (input > l.n)
+        throw std::invalid_argument("packedDiagonals: INPUT no cabe en el bloque");
+
+    for (size_t g = 0; g < l.n2; ++g) {
+        for (size_t b = 0; b < l.n1; ++b) {
+            auto& d = diags[g * l.n1 + b];
+            for (size_t i = 0; i < l.n; ++i) {
+                size_t row = (i + l.m - g * l.n1) % l.m;
+                size_t col = (i + b) % l.n;
+                if (col < input)
+                    d[i] = W1[row][col];
+            }
+        }
+    }
+    return diags;
+}
+
+// v (one value per neuron) repeated in every slot: slot i holds v[i mod m]
+inline std::vector<double> packedRepeat(const PackedMLPLayout& l, const std::vector<double>& v)
+{
+    std::vector<double> out(l.n);
+    for (size_t i = 0; i < l.n; ++i)
+        out[i] = v[i % l.m];
+    return out;
+}
+
+inline std::vector<double> packedLayer2(const PackedMLPLayout& l,
+                                        const std::vector<std::vector<double>>& W2)
+{
+    std::vector<double> out(l.n, 0.0);
+    for (size_t o = 0; o < W2.size(); ++o)
+        for (size_t j = 0; j < l.m; ++j)
+            out[o * l.m + j] = W2[o][j];
+    return out;
+}
+
+// b2[o] in the slot where logit o lands
+inline std::vector<double> packedBias2(const PackedMLPLayout& l, const std::vector<double>& b2)
+{
+    std::vector<double> out(l.n, 0.0);
+    for (size_t o = 0; o < b2.size(); ++o)
+        out[o * l.m] = b2[o];
+    return out;
+}
+
+// Every rotation the packed forward needs (baby, giant, stride and block sums)
+inline std::vector<int> packedRotations(const PackedMLPLayout& l)
+{
+    std::set<int> idx;
+    for (size_t b = 1; b < l.n1; ++b) idx.insert(static_cast<int>(b));
+    for (size_t g = 1; g < l.n2; ++g) idx.insert(static_cast<int>(g * l.n1));
+    for (size_t s = l.m; s < l.n; s <<= 1) idx.insert(static_cast<int>(s));
+    for (size_t s = 1; s < l.m; s <<= 1) idx.insert(static_cast<int>(s));
+    return std::vector<int>(idx.begin(), idx.end());
+}
@@ -0,0 +1,91 @@
+#include "nn_profiler.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+void ProfileData::merge(const ProfileData& other)
+{
+    runs += other.runs;
+    for (const auto& [name, s] : other.sections) {
+        sections[name].calls += s.calls;
+        sections[name].ns += s.ns;
+    }
+    for (const auto& [name, n] : other.ops)
+        ops[name] += n;
+    if (neuronNs.size() < other.neuronNs.size())
+        neuronNs.resize(other.neuronNs.size(), 0);
+    for (size_t j = 0; j < other.neuronNs.size(); ++j)
+        neuronNs[j] += other.neuronNs[j];
+}
+
+std::string ProfileData::toJson() const
+{
+    // Section and op names are identifiers chosen in the code: no escaping
+    std::ostringstream os;
+    os << "{\"runs\":" << runs << ",\"sections\":{";
+    bool first = true;
+    for (const auto& [name, s] : sections) {
+        os << (first ? "" : ",") << '"' << name << "\":{\"calls\":" << s.calls
+           << ",\"ms\":" << s.ns / 1e6 << '}';
+        first = false;
+    }
+    os << "},\"ops\":{";
+    first = true;
+    for (const auto& [name, n] : ops) {
+        os << (first ? "" : ",") << '"' << name << "\":" << n;
+        first = false;
+    }
+    os << "},\"neuron_ms\":[";
+    for (size_t j = 0; j < neuronNs.size(); ++j)
+        os << (j ? "," : "") << neuronNs[j] / 1e6;
+    os << "]}";
+    return os.str();
+}
+
+NNProfiler::NNProfiler(std::string runsPath) : runsPath_(std::move(runsPath)) {}
+
+void NNProfiler::addTime(const std::string& section, uint64_t ns)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& s = current_.sections[section];
+    s.calls++;
+    s.ns += ns;
+}
+
+void NNProfiler::addNeuronTime(size_t neuron, uint64_t ns)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_.neuronNs.size() <= neuron)
+        current_.neuronNs.resize(neuron + 1, 0);
+    current_.neuronNs[neuron] += ns;
+}
+
+void NNProfiler::count(const std::string& op, uint64_t n)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.ops[op] += n;
+}
+
+void NNProfiler::endRun()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.runs = 1;
+    if (!runsPath_.empty()) {
+        std::ofstream out(runsPath_, std::ios::app);
+        if (!out)
+            throw std::runtime_error("NNProfiler: no se pudo abrir " + runsPath_);
+        out << current_.toJson() << '\n';
+    }
+    total_.merge(current_);
+    current_ = ProfileData{};
+}
+
+void NNProfiler::writeAggregate(const std::string& path) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+        throw std::runtime_error("NNProfiler: no se pudo abrir " + path);
+    out << total_.toJson() << '\n';
+}
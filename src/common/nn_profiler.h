@@ -0,0 +1,87 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Wall time of a named section, summed over its calls
+struct ProfileSection {
+    uint64_t calls = 0;
+    uint64_t ns = 0;
+};
+
+// Counters of one inference (or, merged, of a whole campaign)
+struct ProfileData {
+    uint64_t runs = 0;
+    std::map<std::string, ProfileSection> sections;  // e.g. "layer1.reduceSum"
+    std::map<std::string, uint64_t> ops;             // e.g. "key_switch", "rescale"
+    std::vector<uint64_t> neuronNs;                  // hidden neuron j, layer 1 chain
+
+    void merge(const ProfileData& other);
+    std::string toJson() const;
+};
+
+// Per-layer/per-neuron timers and operation counters for the NN forward.
+// Attached to HEEnv::profiler; every entry point is a no-op through a null
+// pointer, so the unprofiled path only pays one branch. Thread-safe (the
+// hidden neurons record from several threads).
+class NNProfiler {
+public:
+    // runsPath: JSON lines file, one object per endRun ("" = no per-run file)
+    explicit NNProfiler(std::string runsPath = "");
+
+    void addTime(const std::string& section, uint64_t ns);
+    void addNeuronTime(size_t neuron, uint64_t ns);
+    void count(const std::string& op, uint64_t n = 1);
+
+    // Closes the current inference: appends it to runsPath and merges it
+    // into the campaign aggregate
+    void endRun();
+    const ProfileData& aggregate() const { return total_; }
+    void writeAggregate(const std::string& path) const;
+
+private:
+    std::string runsPath_;
+    mutable std::mutex mutex_;
+    ProfileData current_;
+    ProfileData total_;
+};
+
+// Times its own lifetime into section (and into neuron, when >= 0)
+class ProfileScope {
+public:
+    ProfileScope(NNProfiler* profiler, const char* section, long neuron = -1)
+        : profiler_(profiler), section_(section), neuron_(neuron)
+    {
+        if (profiler_)
+            start_ = std::chrono::steady_clock::now();
+    }
+    ~ProfileScope()
+    {
+        if (!profiler_)
+            return;
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+        profiler_->addTime(section_, ns);
+        if (neuron_ >= 0)
+            profiler_->addNeuronTime(static_cast<size_t>(neuron_), ns);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    NNProfiler* profiler_;
+    const char* section_;
+    long neuron_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+inline void profileCount(NNProfiler* profiler, const char* op, uint64_t n = 1)
+{
+    if (profiler)
+        profiler->count(op, n);
+}
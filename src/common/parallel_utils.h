@@ -0,0 +1,77 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs fn(i, worker) for i in [0, n) on `threads` std::threads (the caller
+// is worker 0). Indices are handed out one at a time, so uneven tasks
+// balance out; worker < threads can index per-thread scratch. threads <= 1
+// runs inline. The first exception thrown by fn is rethrown after joining.
+inline void parallel_for(size_t n, size_t threads,
+                         const std::function<void(size_t i, size_t worker)>& fn)
+{
+    threads = std::min(threads, n);
+    if (threads <= 1) {
+        for (size_t i = 0; i < n; ++i)
+            fn(i, 0);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&](size_t worker) {
+        for (;;) {
+            size_t i = next.fetch_add(1);
+            if (i >= n)
+                return;
+            try {
+                fn(i, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = std::current_exception();
+                next.store(n); // stop handing out work
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (size_t w = 1; w < threads; ++w)
+        pool.emplace_back(work, w);
+    work(0);
+    for (auto& t : pool)
+        t.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+// In-place pairwise reduction of every group: groups[g][0] ends up holding
+// the sum of groups[g]. Each level runs the pairs of all groups in one
+// parallel_for. The tree is fixed (independent of `threads`), so the result
+// is the same bit for bit however many threads run it.
+template <typename T, typename AddFn>
+void parallel_tree_reduce(std::vector<std::vector<T>>& groups, size_t threads, AddFn add)
+{
+    size_t longest = 0;
+    for (auto& g : groups)
+        longest = std::max(longest, g.size());
+
+    for (size_t stride = 1; stride < longest; stride <<= 1) {
+        const size_t span = 2 * stride;
+        const size_t perGroup = (longest + span - 1) / span;
+        parallel_for(groups.size() * perGroup, threads, [&](size_t t, size_t) {
+            auto& g = groups[t / perGroup];
+            size_t i = (t % perGroup) * span;
+            if (i + stride < g.size())
+                add(g[i], g[i + stride]);
+        });
+    }
+}
@@ -0,0 +1,113 @@
+#include "rotation_key_cache.h"
+#include "snapshot_store.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+#include <unistd.h>
+
+RotationKeyCache::RotationKeyCache(std::string contextId, RotationKeyConfig cfg, RotationKeyHooks hooks)
+    : contextId_(std::move(contextId)), cfg_(std::move(cfg)), hooks_(std::move(hooks))
+{
+    if (!hooks_.generate || !hooks_.evict)
+        throw std::invalid_argument("RotationKeyCache: faltan los hooks generate/evict");
+    if (!cfg_.dir.empty()) {
+        if (!hooks_.save || !hooks_.load)
+            throw std::invalid_argument("RotationKeyCache: faltan los hooks save/load");
+        std::filesystem::create_directories(cfg_.dir);
+    }
+}
+
+std::string RotationKeyCache::pathFor(int step) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(fnv1a64(contextId_ + " step=" + std::to_string(step))));
+    return cfg_.dir + "/rotkey_" + name + ".key";
+}
+
+void RotationKeyCache::fetch(int step)
+{
+    size_t bytes = 0;
+    if (!cfg_.dir.empty()) {
+        const std::string p = pathFor(step);
+        if (std::filesystem::exists(p) && (bytes = hooks_.load(step, p)) > 0) {
+            stats_.loaded++;
+        } else {
+            bytes = hooks_.generate(step);
+            stats_.generated++;
+            // Per process, so concurrent writers of the same key do not clash
+            const std::string tmpPath = p + ".tmp." + std::to_string(::getpid());
+            try {
+                hooks_.save(step, tmpPath);
+                if (std::rename(tmpPath.c_str(), p.c_str()) != 0)
+                    throw std::runtime_error("RotationKeyCache: no se pudo renombrar " + tmpPath + " a " + p);
+            } catch (...) {
+                std::remove(tmpPath.c_str());
+                throw;
+            }
+        }
+    } else {
+        bytes = hooks_.generate(step);
+        stats_.generated++;
+    }
+    resident_[step].bytes = bytes;
+    bytes_ += bytes;
+}
+
+void RotationKeyCache::require(const std::vector<int>& steps)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t now = ++clock_;
+    bool fetched = false;
+    for (int step : steps) {
+        if (!resident_.count(step)) {
+            fetch(step);
+            fetched = true;
+        }
+        resident_[step].lastUse = now;
+    }
+    if (fetched)
+        evictOverBudget(steps);
+}
+
+void RotationKeyCache::evictOverBudget(const std::vector<int>& pinned)
+{
+    if (cfg_.budgetBytes == 0)
+        return;
+    while (bytes_ > cfg_.budgetBytes) {
+        auto victim = resident_.end();
+        for (auto it = resident_.begin(); it != resident_.end(); ++it) {
+            if (std::find(pinned.begin(), pinned.end(), it->first) != pinned.end())
+                continue;
+            if (victim == resident_.end() || it->second.lastUse < victim->second.lastUse)
+                victim = it;
+        }
+        if (victim == resident_.end())
+            return;
+        hooks_.evict(victim->first);
+        bytes_ -= victim->second.bytes;
+        resident_.erase(victim);
+        stats_.evicted++;
+    }
+}
+
+bool RotationKeyCache::resident(int step) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return resident_.count(step) > 0;
+}
+
+size_t RotationKeyCache::residentBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+RotationKeyCache::Stats RotationKeyCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
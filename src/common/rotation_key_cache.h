@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// How a library makes, stores and drops the rotation key of one step.
+// generate/load install the key in the library and return its resident size
+// in bytes; load returns 0 when the file cannot be used.
+struct RotationKeyHooks {
+    std::function<size_t(int step)> generate;
+    std::function<void(int step, const std::string& path)> save;
+    std::function<size_t(int step, const std::string& path)> load;
+    std::function<void(int step)> evict;
+};
+
+// Where keys are persisted (empty: memory only), the resident budget
+// (0: unbounded) and the seed key generation runs from when they are
+struct RotationKeyConfig {
+    std::string dir;
+    size_t budgetBytes = 0;
+    uint64_t seed = 0;
+};
+
+// Rotation keys generated on first use instead of up front. With a
+// directory, a key is first looked up in
+//   <dir>/rotkey_<16 hex digits>.key
+// named by the FNV-1a hash of the context id (parameters, seed and secret
+// key fingerprint) and the step, and written there after generation (to a
+// temporary name, then renamed), so processes on the same context share
+// them. Past the budget the least recently required keys are evicted; the
+// keys of the current require() are never evicted, even over budget.
+//
+// require() is thread-safe, but the library's key store is not guarded
+// against concurrent readers: call it before the keys are used from
+// several threads.
+class RotationKeyCache {
+public:
+    struct Stats {
+        uint64_t generated = 0;
+        uint64_t loaded = 0;
+        uint64_t evicted = 0;
+    };
+
+    RotationKeyCache(std::string contextId, RotationKeyConfig cfg, RotationKeyHooks hooks);
+
+    void require(const std::vector<int>& steps);
+
+    bool resident(int step) const;
+    size_t residentBytes() const;
+    Stats stats() const;
+    std::string pathFor(int step) const;
+
+private:
+    struct Entry {
+        size_t bytes = 0;
+        uint64_t lastUse = 0;
+    };
+
+    void fetch(int step);
+    void evictOverBudget(const std::vector<int>& pinned);
+
+    std::string contextId_;
+    RotationKeyConfig cfg_;
+    RotationKeyHooks hooks_;
+    mutable std::mutex mutex_;
+    std::map<int, Entry> resident_;
+    size_t bytes_ = 0;
+    uint64_t clock_ = 0;
+    Stats stats_;
+};
@@ -0,0 +1,139 @@
+#include "snapshot_store.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'K', 'K', 'S', 'S', 'N', 'P', '1'};
+
+uint64_t align8(uint64_t v) { return (v + 7) & ~uint64_t(7); }
+
+void writeOrThrow(FILE* f, const void* data, size_t size, const std::string& path)
+{
+    if (size > 0 && std::fwrite(data, 1, size, f) != size)
+        throw std::runtime_error("SnapshotStore: fallo al escribir " + path);
+}
+
+} // namespace
+
+const uint64_t* SnapshotReader::take(size_t n)
+{
+    if (static_cast<size_t>(end_ - p_) < n)
+        throw std::runtime_error("SnapshotReader: snapshot truncado");
+    const uint64_t* at = p_;
+    p_ += n;
+    return at;
+}
+
+MappedSnapshot::MappedSnapshot(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("MappedSnapshot: no se pudo abrir " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        throw std::runtime_error("MappedSnapshot: " + path + " no es un snapshot valido");
+    }
+    size_ = static_cast<size_t>(st.st_size);
+
+    void* mem = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED)
+        throw std::runtime_error("MappedSnapshot: mmap fallo para " + path + " (errno=" + std::to_string(errno) + ")");
+
+    base_ = static_cast<const uint8_t*>(mem);
+    header_ = reinterpret_cast<const SnapshotHeader*>(base_);
+    // descLen is bounded by the file before align8, which wraps near 2^64
+    const uint64_t room = size_ - sizeof(SnapshotHeader);
+    const uint64_t payload = header_->descLen > room ? size_ + 1
+                                                     : sizeof(SnapshotHeader) + align8(header_->descLen);
+    if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0 ||
+        payload > size_ || header_->words > (size_ - payload) / sizeof(uint64_t)) {
+        munmap(mem, size_);
+        throw std::runtime_error("MappedSnapshot: " + path + " no es un snapshot valido");
+    }
+    words_ = reinterpret_cast<const uint64_t*>(base_ + payload);
+}
+
+MappedSnapshot::~MappedSnapshot()
+{
+    if (base_)
+        munmap(const_cast<uint8_t*>(base_), size_);
+}
+
+std::string MappedSnapshot::description() const
+{
+    return std::string(reinterpret_cast<const char*>(base_ + sizeof(SnapshotHeader)),
+                       header_->descLen);
+}
+
+SnapshotStore::SnapshotStore(std::string dir) : dir_(std::move(dir))
+{
+    std::filesystem::create_directories(dir_);
+}
+
+std::string SnapshotStore::path(const std::string& description) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(fnv1a64(description)));
+    return dir_ + "/" + name + ".snap";
+}
+
+std::unique_ptr<MappedSnapshot> SnapshotStore::load(const std::string& description) const
+{
+    const std::string p = path(description);
+    struct stat st;
+    if (stat(p.c_str(), &st) != 0)
+        return nullptr;
+    auto snap = std::make_unique<MappedSnapshot>(p);
+    if (snap->description() != description)
+        return nullptr;
+    return snap;
+}
+
+void SnapshotStore::store(const std::string& description, const SnapshotWriter& payload) const
+{
+    const std::string outPath = path(description);
+    // Per process, so concurrent writers of the same snapshot do not clash
+    const std::string tmpPath = outPath + ".tmp." + std::to_string(::getpid());
+    FILE* f = std::fopen(tmpPath.c_str(), "wb");
+    if (!f)
+        throw std::runtime_error("SnapshotStore: no se pudo crear " + tmpPath);
+
+    try {
+        SnapshotHeader h{};
+        std::memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.descLen = description.size();
+        h.words = payload.words().size();
+        writeOrThrow(f, &h, sizeof(h), tmpPath);
+
+        static const char zeros[8] = {};
+        writeOrThrow(f, description.data(), description.size(), tmpPath);
+        writeOrThrow(f, zeros, align8(h.descLen) - h.descLen, tmpPath);
+        writeOrThrow(f, payload.words().data(), h.words * sizeof(uint64_t), tmpPath);
+
+        if (std::fclose(f) != 0) {
+            f = nullptr;
+            throw std::runtime_error("SnapshotStore: fallo al escribir " + tmpPath);
+        }
+        f = nullptr;
+
+        if (std::rename(tmpPath.c_str(), outPath.c_str()) != 0)
+            throw std::runtime_error("SnapshotStore: no se pudo renombrar " + tmpPath + " a " + outPath);
+    } catch (...) {
+        if (f) std::fclose(f);
+        std::remove(tmpPath.c_str());
+        throw;
+    }
+}
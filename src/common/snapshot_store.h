@@ -0,0 +1,123 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Content-addressed store of clean pipeline ciphertexts (after encrypt,
+// after each server op), shared by every campaign process that runs the same
+// prefix. A snapshot is named by the FNV-1a hash of its description: the
+// parameters, seeds and ops that produced it, plus a fingerprint of the
+// secret key. Backends lay their ciphertexts out as raw uint64 words.
+//
+// File <dir>/<16 hex digits>.snap (little endian, 8-byte aligned):
+//   SnapshotHeader
+//   description  descLen bytes, padded to 8
+//   payload      words uint64
+//
+// Files are written to a temporary name and renamed, so a reader maps either
+// nothing or a complete snapshot. The description is compared on load, so a
+// hash collision reads as a miss.
+struct SnapshotHeader {
+    char magic[8];      // "CKKSSNP1"
+    uint64_t descLen;
+    uint64_t words;
+};
+
+constexpr uint64_t FNV1A_OFFSET = 14695981039346656037ULL;
+constexpr uint64_t FNV1A_PRIME  = 1099511628211ULL;
+
+inline uint64_t fnv1a64(const void* data, size_t n, uint64_t h = FNV1A_OFFSET)
+{
+    const auto* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= FNV1A_PRIME;
+    }
+    return h;
+}
+
+inline uint64_t fnv1a64(const std::string& s, uint64_t h = FNV1A_OFFSET)
+{
+    return fnv1a64(s.data(), s.size(), h);
+}
+
+// Payload under construction
+class SnapshotWriter {
+public:
+    void put(uint64_t w) { words_.push_back(w); }
+    void putDouble(double d)
+    {
+        uint64_t w;
+        std::memcpy(&w, &d, sizeof(w));
+        words_.push_back(w);
+    }
+    void putWords(const uint64_t* w, size_t n) { words_.insert(words_.end(), w, w + n); }
+    // Reserves n words and returns them for the caller to fill
+    uint64_t* extend(size_t n)
+    {
+        words_.resize(words_.size() + n);
+        return words_.data() + words_.size() - n;
+    }
+
+    const std::vector<uint64_t>& words() const { return words_; }
+
+private:
+    std::vector<uint64_t> words_;
+};
+
+// Sequential view over a mapped payload; throws std::runtime_error on overrun
+class SnapshotReader {
+public:
+    SnapshotReader(const uint64_t* words, size_t n) : p_(words), end_(words + n) {}
+
+    uint64_t get() { return *take(1); }
+    double getDouble()
+    {
+        double d;
+        std::memcpy(&d, take(1), sizeof(d));
+        return d;
+    }
+    const uint64_t* take(size_t n);
+    bool done() const { return p_ == end_; }
+
+private:
+    const uint64_t* p_;
+    const uint64_t* end_;
+};
+
+// One snapshot file mapped read-only
+class MappedSnapshot {
+public:
+    explicit MappedSnapshot(const std::string& path);
+    ~MappedSnapshot();
+
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    std::string description() const;
+    SnapshotReader reader() const { return SnapshotReader(words_, header_->words); }
+
+private:
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    const SnapshotHeader* header_ = nullptr;
+    const uint64_t* words_ = nullptr;
+};
+
+class SnapshotStore {
+public:
+    // Creates dir if needed
+    explicit SnapshotStore(std::string dir);
+
+    std::string path(const std::string& description) const;
+
+    // nullptr when there is no snapshot for description
+    std::unique_ptr<MappedSnapshot> load(const std::string& description) const;
+    void store(const std::string& description, const SnapshotWriter& payload) const;
+
+private:
+    std::string dir_;
+};
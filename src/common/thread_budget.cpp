@@ -0,0 +1,146 @@
+#include "thread_budget.h"
+#include "parallel_utils.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+// CPUs the process may run on, in order
+std::vector<int> allowed_cpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &set))
+                cpus.push_back(c);
+    }
+    return cpus;
+}
+
+int current_omp_threads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+} // namespace
+
+uint32_t available_cores()
+{
+    size_t n = allowed_cpus().size();
+    if (n == 0)
+        n = std::thread::hardware_concurrency();
+    return n > 0 ? static_cast<uint32_t>(n) : 1;
+}
+
+std::vector<ThreadSplit> candidate_splits(uint32_t cores)
+{
+    if (cores == 0)
+        throw std::invalid_argument("candidate_splits: cores debe ser > 0");
+    std::vector<ThreadSplit> out;
+    for (uint32_t omp = 1; omp <= cores; ++omp) {
+        if (cores % omp)
+            continue;
+        ThreadSplit s;
+        s.workers = cores / omp;
+        s.ompThreads = omp;
+        out.push_back(s);
+    }
+    return out;
+}
+
+ThreadSplit heuristic_split(uint32_t cores, uint32_t logN, uint32_t limbs,
+                            const std::string& stage)
+{
+    ThreadSplit best;
+    best.workers = cores;
+    if (logN < 14 || stage == "decode" || limbs <= 1)
+        return best;
+
+    // Largest divisor of cores that does not exceed the limb count
+    for (const auto& s : candidate_splits(cores))
+        if (s.ompThreads <= limbs)
+            best = s;
+    return best;
+}
+
+void apply_thread_split(const ThreadSplit& split, uint32_t worker, bool pin)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(static_cast<int>(split.ompThreads));
+#endif
+    if (!pin)
+        return;
+
+    std::vector<int> cpus = allowed_cpus();
+    if (cpus.empty())
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (uint32_t k = 0; k < split.ompThreads; ++k)
+        CPU_SET(cpus[(worker * split.ompThreads + k) % cpus.size()], &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0)
+        throw std::runtime_error("apply_thread_split: pthread_setaffinity_np fallo (" +
+                                 std::to_string(rc) + ")");
+}
+
+SavedThreadSettings::SavedThreadSettings()
+{
+    CPU_ZERO(&affinity_);
+    haveAffinity_ = pthread_getaffinity_np(pthread_self(), sizeof(affinity_), &affinity_) == 0;
+    ompThreads_ = current_omp_threads();
+}
+
+SavedThreadSettings::~SavedThreadSettings()
+{
+    if (haveAffinity_)
+        pthread_setaffinity_np(pthread_self(), sizeof(affinity_), &affinity_);
+#ifdef _OPENMP
+    omp_set_num_threads(ompThreads_);
+#endif
+}
+
+ThreadSplit autotune_split(uint32_t cores, uint32_t itersPerWorker, bool pin,
+                           const ThreadProbeFn& probe)
+{
+    if (itersPerWorker == 0)
+        throw std::invalid_argument("autotune_split: itersPerWorker debe ser > 0");
+
+    SavedThreadSettings saved;
+
+    ThreadSplit best;
+    best.itersPerSec = -1.0;
+    for (ThreadSplit s : candidate_splits(cores)) {
+        // Each worker applies the split on its first probe
+        std::vector<char> applied(s.workers, 0);
+        size_t total = static_cast<size_t>(s.workers) * itersPerWorker;
+        auto start = std::chrono::steady_clock::now();
+        parallel_for(total, s.workers, [&](size_t, size_t worker) {
+            if (!applied[worker]) {
+                apply_thread_split(s, static_cast<uint32_t>(worker), pin);
+                applied[worker] = 1;
+            }
+            probe(static_cast<uint32_t>(worker));
+        });
+        double secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        s.itersPerSec = secs > 0 ? total / secs : 0.0;
+        s.source = "autotune";
+        if (s.itersPerSec > best.itersPerSec)
+            best = s;
+    }
+    return best;
+}
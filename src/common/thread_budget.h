@@ -0,0 +1,60 @@
+#pragma once
+#include <sched.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Split of a core budget between campaign-level iteration workers and the
+// OpenMP threads each worker lends to the library (OpenFHE parallelizes
+// limb-wise loops with OpenMP). workers * ompThreads <= cores.
+struct ThreadSplit {
+    uint32_t workers = 1;
+    uint32_t ompThreads = 1;
+    // Measured by autotune_split, 0 otherwise
+    double itersPerSec = 0.0;
+    // "heuristic" or "autotune"
+    std::string source = "heuristic";
+};
+
+// Online cores of the process (at least 1)
+uint32_t available_cores();
+
+// Every (workers, ompThreads) with workers * ompThreads == cores
+std::vector<ThreadSplit> candidate_splits(uint32_t cores);
+
+// Split without measuring. The OpenMP loops run over limbs, so more threads
+// than limbs stay idle, and below logN 14 (or in decode, which is serial)
+// the fork/join cost outweighs the limb work: all cores go to workers.
+ThreadSplit heuristic_split(uint32_t cores, uint32_t logN, uint32_t limbs,
+                            const std::string& stage);
+
+// Sets the OpenMP threads of the calling thread (no-op without OpenMP) and,
+// if pin, binds it to cores [worker*ompThreads, (worker+1)*ompThreads).
+// OpenMP threads started from it inherit the binding.
+void apply_thread_split(const ThreadSplit& split, uint32_t worker, bool pin);
+
+// Saves the calling thread's OpenMP setting and CPU affinity and restores
+// them on destruction. parallel_for runs worker 0 on the caller, so a split
+// applied there would otherwise outlive the loop.
+class SavedThreadSettings {
+public:
+    SavedThreadSettings();
+    ~SavedThreadSettings();
+    SavedThreadSettings(const SavedThreadSettings&) = delete;
+    SavedThreadSettings& operator=(const SavedThreadSettings&) = delete;
+
+private:
+    cpu_set_t affinity_;
+    bool haveAffinity_;
+    int ompThreads_;
+};
+
+// One probe iteration on the given worker (e.g. run_iteration on some flip)
+using ThreadProbeFn = std::function<void(uint32_t worker)>;
+
+// Runs itersPerWorker probes per worker for every candidate split and
+// returns the fastest in iterations per second. The caller thread's
+// affinity and OpenMP setting are restored afterwards.
+ThreadSplit autotune_split(uint32_t cores, uint32_t itersPerWorker, bool pin,
+                           const ThreadProbeFn& probe);
@@ -148,6 +148,76 @@ CKKSAccuracyMetrics EvaluateCKKSAccuracy(
     };
 }
 
+ComplexAccuracyMetrics EvaluateCKKSAccuracyComplex(
+    const std::vector<cdouble>& golden,
+    const std::vector<cdouble>& ckks,
+    size_t size,
+    const RelativeErrorThresholds& thr
+) {
+    if (golden.size() < size || ckks.size() < size)
+        throw std::invalid_argument("EvaluateCKKSAccuracyComplex: size mismatch");
+
+    if (size == 0)
+        throw std::invalid_argument("EvaluateCKKSAccuracyComplex: empty vectors");
+
+    double l2_diff_sq   = 0.0;
+    double l2_golden_sq = 0.0;
+
+    double linf_abs_error = 0.0;
+    double linf_rel_error = 0.0;
+    double linf_mod_error = 0.0;
+    double linf_phase_error = 0.0;
+
+    SlotErrorStats stats;
+
+    for (size_t i = 0; i < size; ++i) {
+        const cdouble g = golden[i];
+        const cdouble y = ckks[i];
+
+        const double abs_g    = std::abs(g);
+        const double abs_diff = std::abs(y - g);
+
+        l2_diff_sq   += std::norm(y - g);
+        l2_golden_sq += std::norm(g);
+
+        linf_abs_error = std::max(linf_abs_error, abs_diff);
+
+        double rel_err;
+        if (abs_g < thr.zero_eps) {
+            rel_err = abs_diff;
+        } else {
+            rel_err = abs_diff / abs_g;
+            linf_rel_error = std::max(linf_rel_error, rel_err);
+            linf_mod_error = std::max(linf_mod_error,
+                                      std::abs(std::abs(y) - abs_g) / abs_g);
+            // arg(y * conj(g)) = arg(y) - arg(g) without wrap-around issues
+            linf_phase_error = std::max(linf_phase_error,
+                                        std::abs(std::arg(y * std::conj(g))));
+        }
+
+        if (rel_err > thr.failed)
+            stats.failed++;
+        else if (rel_err > thr.corrupted)
+            stats.corrupted++;
+        else if (rel_err > thr.degraded)
+            stats.degraded++;
+        else
+            stats.correct++;
+    }
+
+    const double denom = std::max(std::sqrt(l2_golden_sq), thr.zero_eps);
+    const double l2_rel_error = std::sqrt(l2_diff_sq) / denom;
+    const double bits_precision = (l2_rel_error > 0.0) ? -std::log2(l2_rel_error)
+                                    : std::numeric_limits<double>::infinity();
+
+    return {
+        {l2_rel_error, linf_rel_error, linf_abs_error, bits_precision},
+        linf_mod_error,
+        linf_phase_error,
+        stats
+    };
+}
+
 SlotErrorStats categorize_slots_relative(
     const std::vector<double>& golden,
     const std::vector<double>& output,
@@ -227,6 +297,36 @@ double compute_rel_norm2(const std::vector<double>& v1,
     return std::sqrt(num) / std::sqrt(den);
 }
 
+void evaluate_slots(const cdouble* u,
+                    size_t slots,
+                    const std::vector<size_t>& slotIdx,
+                    cdouble* out)
+{
+    if (slots == 0)
+        throw std::invalid_argument("evaluate_slots: slots must be > 0");
+
+    const uint64_t M4 = 4 * static_cast<uint64_t>(slots);
+    const double two_pi = 2.0 * M_PI;
+
+    for (size_t k = 0; k < slotIdx.size(); ++k) {
+        if (slotIdx[k] >= slots)
+            throw std::out_of_range("evaluate_slots: slot index out of range");
+
+        // 5^j mod 4*slots, same rotation group the full FFT walks
+        uint64_t e = 1;
+        for (size_t j = 0; j < slotIdx[k]; ++j)
+            e = (e * 5) % M4;
+
+        const double angle = two_pi * static_cast<double>(e) / static_cast<double>(M4);
+        const cdouble z(std::cos(angle), std::sin(angle));
+
+        cdouble acc = u[slots - 1];
+        for (size_t i = slots - 1; i-- > 0;)
+            acc = acc * z + u[i];
+
+        out[k] = acc;
+    }
+}
 
 // if logMin=logMax=0 it samples from [-1,1]
 std::vector<double> uniform_dist(uint32_t batchSize,
@@ -40,6 +40,14 @@ struct CKKSAccuracyMetrics {
     double bits_precision;   // -log2(l2_rel_error)
 };
 
+// Complex slots compared as complex numbers, not as 2*slots reals.
+struct ComplexAccuracyMetrics {
+    CKKSAccuracyMetrics base;  // l2/linf on |y_i - g_i|
+    double linf_mod_error;     // max_i ||y_i| - |g_i|| / |g_i|
+    double linf_phase_error;   // max_i |arg(y_i / g_i)|, radians
+    SlotErrorStats stats;      // categorize_slots_relative on |y_i - g_i| / |g_i|
+};
+
 struct ErrorThresholds {
     double abs_zero;        // qué se considera "cero" en golden
 
@@ -106,6 +114,15 @@ CKKSAccuracyMetrics EvaluateCKKSAccuracy(
 );
 
 
+// Single pass over interleaved cdouble: accuracy, modulus and phase error
+// and per-slot categorization of the first `size` slots.
+ComplexAccuracyMetrics EvaluateCKKSAccuracyComplex(
+    const std::vector<cdouble>& golden,
+    const std::vector<cdouble>& ckks,
+    size_t size,
+    const RelativeErrorThresholds& thr = {}
+);
+
 SlotErrorStats categorize_slots_relative(
     const std::vector<double>& golden,
     const std::vector<double>& output,
@@ -125,6 +142,15 @@ double percentile(std::vector<double>& v, double p);
 
 double compute_rel_norm2(const std::vector<double>& v1, const std::vector<double>& v2);
 
+// Evaluates only the requested slots of the CKKS special FFT.
+// u holds the packed, scaled coefficients (u_k = m_{k*gap} + i*m_{k*gap+N/2})
+// and slot j is m(zeta^{5^j}) with zeta = exp(2*pi*i / (4*slots)), computed
+// by Horner in O(slots) per slot. Worth it while slotIdx.size() < log2(slots).
+void evaluate_slots(const cdouble* u,
+                    size_t slots,
+                    const std::vector<size_t>& slotIdx,
+                    cdouble* out);
+
 std::vector<double> uniform_dist(uint32_t batchSize, int64_t  logMin, int64_t logMax, uint64_t seed, bool verbose=false);
 
 
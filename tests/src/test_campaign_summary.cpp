@@ -0,0 +1,149 @@
+#include "campaign_summary.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Exact quantile with the rank LogHistogram::quantile uses
+static double exactQuantile(std::vector<double> v, double q)
+{
+    std::sort(v.begin(), v.end());
+    size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(q * v.size())));
+    return v[rank - 1];
+}
+
+static void checkQuantiles(const std::vector<double>& values)
+{
+    LogHistogram h;
+    for (double v : values)
+        h.add(v);
+    const double factor = std::pow(10.0, 1.0 / LogHistogram::kBinsPerDecade) * (1 + 1e-12);
+    for (double q : {0.0, 0.01, 0.25, 0.5, 0.9, 0.95, 0.99, 1.0}) {
+        const double exact = exactQuantile(values, q);
+        const double est = h.quantile(q);
+        CHECK(est <= exact * factor && est >= exact / factor);
+    }
+    CHECK(h.min == *std::min_element(values.begin(), values.end()));
+    CHECK(h.max == *std::max_element(values.begin(), values.end()));
+}
+
+static std::vector<std::string> lines(const CsvEncoder& e)
+{
+    std::vector<std::string> out;
+    std::istringstream in(std::string(e.data(), e.size()));
+    for (std::string l; std::getline(in, l);)
+        out.push_back(l);
+    return out;
+}
+
+int main()
+{
+    // Quantiles within one bin width of the exact ones
+    {
+        std::mt19937 gen(11);
+        std::uniform_real_distribution<double> logU(-15.0, 8.0);
+        std::lognormal_distribution<double> logN(-3.0, 2.0);
+        std::vector<double> a, b, c;
+        for (int i = 0; i < 20000; ++i) {
+            a.push_back(std::pow(10.0, logU(gen)));
+            b.push_back(logN(gen));
+        }
+        for (int i = 1; i <= 7; ++i)
+            c.push_back(i * 1e-3);
+        checkQuantiles(a);
+        checkQuantiles(b);
+        checkQuantiles(c);
+        checkQuantiles({42.0});
+    }
+
+    // Mean, zeros, infinities and NaNs
+    {
+        LogHistogram h;
+        CHECK(std::isnan(h.quantile(0.5)));
+        CHECK(std::isnan(h.mean()));
+        h.add(0.0);
+        h.add(2.0);
+        h.add(4.0);
+        h.add(std::numeric_limits<double>::quiet_NaN());
+        h.add(std::numeric_limits<double>::infinity());
+        CHECK(h.count() == 4);
+        CHECK(h.nan == 1);
+        CHECK(h.mean() == 2.0);
+        CHECK(h.bins[0] == 1);
+        CHECK(h.bins[LogHistogram::kBins - 1] == 1);
+        CHECK(h.quantile(0.0) == 0.0);
+        CHECK(std::isinf(h.quantile(1.0)));
+    }
+
+    // merge() equals adding everything to one histogram
+    {
+        std::mt19937 gen(5);
+        std::lognormal_distribution<double> dist(0.0, 3.0);
+        LogHistogram all, left, right;
+        for (int i = 0; i < 5000; ++i) {
+            double v = dist(gen);
+            all.add(v);
+            (i % 3 ? left : right).add(v);
+        }
+        left.merge(right);
+        CHECK(left.bins == all.bins);
+        CHECK(left.count() == all.count());
+        CHECK(left.min == all.min && left.max == all.max);
+        CHECK_NEAR(left.mean(), all.mean(), 1e-12 * all.mean());
+        CHECK(left.quantile(0.9) == all.quantile(0.9));
+    }
+
+    // Rows per level; crashed flips count but add no l2
+    {
+        SlotErrorStats s{};
+        s.correct = 3;
+        s.failed = 1;
+        CampaignSummary sum(false, true);
+        sum.add(0, 5, 2, 1e-3, false, s, false);
+        sum.add(1, 5, 2, 1.0, true, s, false);
+        sum.add(1, 7, 3, 0.0, true, s, true);
+        CHECK(sum.total() == 3);
+
+        CsvEncoder out;
+        sum.encode(out, "9");
+        const auto rows = lines(out);
+        CHECK(rows.size() == 1 + 2 + 2 + 3);
+        CHECK(rows[0].rfind("9,all,,,,3,2,", 0) == 0);
+        CHECK(std::count_if(rows.begin(), rows.end(), [](const std::string& r) {
+            return r.rfind("9,coeff,", 0) == 0;
+        }) == 0);
+        CHECK(std::find(rows.begin(), rows.end(),
+                        "9,limb_bit,1,,3,1,1,1,1,3,0,0,1,,,,,,,") != rows.end());
+        // Every row has the header's fields plus the prefix
+        const std::string header = CampaignSummary::header();
+        const auto headerCommas = std::count(header.begin(), header.end(), ',');
+        for (const auto& r : rows)
+            CHECK(std::count(r.begin(), r.end(), ',') == headerCommas + 1);
+
+        CampaignSummary coeffs(true, false);
+        coeffs.add(0, 5, 2, 1e-3, false, s, false);
+        CsvEncoder out2;
+        coeffs.encode(out2);
+        const auto rows2 = lines(out2);
+        CHECK(std::find_if(rows2.begin(), rows2.end(), [](const std::string& r) {
+            return r.rfind("coeff,,5,,1,", 0) == 0;
+        }) != rows2.end());
+
+        // l2_hist: 1e-3 and 1.0 land in the bins with lower edges -3 and 0
+        CHECK(std::find(rows.begin(), rows.end(),
+                        "9,limb_bit,1,,2,1,1,1,0,3,0,0,1,1,1,1,1,1,1,0:1") != rows.end());
+        CHECK(rows[0].size() > 8 && rows[0].compare(rows[0].size() - 8, 8, "-3:1;0:1") == 0);
+
+        CampaignSummary empty;
+        CsvEncoder out3;
+        empty.encode(out3);
+        CHECK(out3.empty());
+    }
+
+    return test_result("campaign_summary");
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cmath>
+#include <iostream>
+
+// Minimal checks for the tests in this directory: a failed check prints
+// its location and expression, and test_result() turns the count into the
+// exit status
+inline int& test_failures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": CHECK(" #cond    \
+                      << ") falló\n";                                       \
+            ++test_failures();                                              \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tol)                                               \
+    do {                                                                    \
+        const double va_ = (a), vb_ = (b);                                  \
+        if (!(std::fabs(va_ - vb_) <= (tol))) {                             \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": " #a " = " << va_ \
+                      << ", " #b " = " << vb_ << '\n';                      \
+            ++test_failures();                                              \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_THROWS(expr)                                                  \
+    do {                                                                    \
+        bool threw_ = false;                                                \
+        try { (void)(expr); } catch (const std::exception&) { threw_ = true; } \
+        if (!threw_) {                                                      \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": " #expr          \
+                      << " no lanzó excepción\n";                           \
+            ++test_failures();                                              \
+        }                                                                   \
+    } while (0)
+
+inline int test_result(const char* name)
+{
+    if (test_failures()) {
+        std::cerr << "[FAIL] " << name << ": " << test_failures() << " checks\n";
+        return 1;
+    }
+    std::cout << "[OK] " << name << '\n';
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "cipher_integrity.h"
+#include "test_check.h"
+
+#include <random>
+#include <vector>
+
+// One bit at a time, as count_bit_ones counts them after the transpose
+static std::vector<uint64_t> naiveOnes(const std::vector<uint64_t>& a)
+{
+    std::vector<uint64_t> ones(64, 0);
+    for (uint64_t v : a)
+        for (uint32_t b = 0; b < 64; ++b)
+            ones[b] += (v >> b) & 1;
+    return ones;
+}
+
+int main()
+{
+    std::mt19937_64 gen(3);
+
+    // Transpose + popcount against a plain bit loop, across the 64-word
+    // blocks and the tail
+    for (size_t n : {0, 1, 63, 64, 65, 128, 1000}) {
+        std::vector<uint64_t> a(n);
+        for (auto& v : a)
+            v = gen();
+        uint64_t ones[64] = {};
+        count_bit_ones(a.data(), n, ones);
+        const auto expected = naiveOnes(a);
+        for (uint32_t b = 0; b < 64; ++b)
+            CHECK(ones[b] == expected[b]);
+    }
+    // A single bit per word: a misplaced transpose shows up as a wrong column
+    {
+        std::vector<uint64_t> a(64);
+        for (size_t i = 0; i < 64; ++i)
+            a[i] = uint64_t(1) << ((i * 7) % 64);
+        uint64_t ones[64] = {};
+        count_bit_ones(a.data(), a.size(), ones);
+        for (uint32_t b = 0; b < 64; ++b)
+            CHECK(ones[b] == 1);
+    }
+
+    // bit_probability against counting [0, q) for small q
+    for (uint64_t q = 1; q <= 300; ++q) {
+        for (uint32_t b = 0; b < 10; ++b) {
+            uint64_t set = 0;
+            for (uint64_t x = 0; x < q; ++x)
+                set += (x >> b) & 1;
+            CHECK_NEAR(bit_probability(q, b), static_cast<double>(set) / q, 1e-15);
+        }
+    }
+    CHECK(bit_probability(uint64_t(1) << 60, 59) == 0.5);
+    CHECK(bit_probability(uint64_t(1) << 60, 60) == 0.0);
+    // Top bit of q = 2^59 + 2^58: one third of [0, q) has bit 59 set
+    CHECK_NEAR(bit_probability((uint64_t(1) << 59) + (uint64_t(1) << 58), 59), 1.0 / 3.0, 1e-15);
+
+    // count_out_of_range
+    {
+        const std::vector<uint64_t> a = {0, 9, 10, 11, ~uint64_t(0)};
+        CHECK(count_out_of_range(a.data(), a.size(), 10) == 3);
+        CHECK(count_out_of_range(a.data(), 0, 10) == 0);
+    }
+
+    // Wilson-Hilferty p-value against chi-square table values
+    {
+        IntegrityStats s;
+        CHECK(s.pValue() == 1.0);
+        s.dof = 60;
+        s.chi2 = 79.08;   // 95th percentile
+        CHECK_NEAR(s.pValue(), 0.05, 0.002);
+        s.dof = 10;
+        s.chi2 = 23.21;   // 99th percentile
+        CHECK_NEAR(s.pValue(), 0.01, 0.001);
+        s.chi2 = 9.342;   // median
+        CHECK_NEAR(s.pValue(), 0.5, 0.01);
+    }
+
+    // Uniform residues pass; a forced bit or a residue >= q does not
+    {
+        const uint64_t q = (uint64_t(1) << 59) + (uint64_t(1) << 40) + 1;
+        std::uniform_int_distribution<uint64_t> residue(0, q - 1);
+        std::vector<uint64_t> a(1 << 14);
+        for (auto& v : a)
+            v = residue(gen);
+
+        IntegrityStats clean = check_limb(a.data(), a.size(), q);
+        CHECK(clean.residues == a.size());
+        CHECK(clean.outOfRange == 0);
+        CHECK(clean.dof == 60);
+        CHECK(clean.pValue() > 1e-3);
+        CHECK(!integrity_suspect(clean, 1e-3));
+
+        auto biased = a;
+        for (size_t i = 0; i < biased.size() / 8; ++i)
+            biased[i] |= uint64_t(1) << 17;
+        IntegrityStats skewed = check_limb(biased.data(), biased.size(), q);
+        CHECK(skewed.outOfRange == 0);
+        CHECK(skewed.pValue() < 1e-6);
+        CHECK(skewed.worstDeviation > 0.05);
+        CHECK(integrity_suspect(skewed, 1e-3));
+        CHECK(!integrity_suspect(skewed, 0.0));
+
+        auto flipped = a;
+        flipped[5] = q;
+        IntegrityStats range = check_limb(flipped.data(), flipped.size(), q);
+        CHECK(range.outOfRange == 1);
+        CHECK(integrity_suspect(range, 0.0));
+
+        IntegrityStats both = clean;
+        both.merge(range);
+        CHECK(both.residues == 2 * a.size());
+        CHECK(both.outOfRange == 1);
+        CHECK(both.dof == 120);
+    }
+
+    return test_result("cipher_integrity");
+}
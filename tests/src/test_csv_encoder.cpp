@@ -0,0 +1,107 @@
+#include "csv_encoder.h"
+#include "test_check.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+static std::string text(const CsvEncoder& e)
+{
+    return std::string(e.data(), e.size());
+}
+
+int main()
+{
+    // Separators, integers at their limits, bools
+    {
+        CsvEncoder e(1);  // grows from one byte
+        e.add(0u).add(-7).add(std::numeric_limits<uint64_t>::max())
+         .add(std::numeric_limits<int64_t>::min()).add(true).add(false);
+        e.endRow();
+        e.add(uint32_t(3)).endRow();
+        CHECK(text(e) == "0,-7,18446744073709551615,-9223372036854775808,1,0\n3\n");
+    }
+
+    // Doubles: shortest form that parses back to the same value
+    {
+        CsvEncoder e(16);
+        e.add(0.5).add(-2.0).add(1e-300).add(0.1);
+        e.endRow();
+        CHECK(text(e) == "0.5,-2,1e-300,0.1\n");
+
+        std::mt19937_64 gen(7);
+        for (int k = 0; k < 10000; ++k) {
+            uint64_t bits = gen();
+            double v;
+            std::memcpy(&v, &bits, sizeof v);
+            if (!std::isfinite(v))
+                continue;
+            e.clear();
+            e.add(v);
+            const std::string s = text(e);
+            CHECK(std::strtod(s.c_str(), nullptr) == v);
+        }
+    }
+
+    // Non-finite doubles
+    {
+        CsvEncoder e;
+        e.add(std::numeric_limits<double>::quiet_NaN())
+         .add(std::numeric_limits<double>::infinity())
+         .add(-std::numeric_limits<double>::infinity());
+        CHECK(text(e) == "nan,inf,-inf");
+    }
+
+    // Strings are quoted only when they need it, as CampaignRegistry::csvEscape
+    {
+        CsvEncoder e(4);
+        e.add(std::string("plain")).add("a,b").add(std::string_view("say \"hi\""))
+         .add("line\nbreak").add("");
+        e.endRow();
+        CHECK(text(e) == "plain,\"a,b\",\"say \"\"hi\"\"\",\"line\nbreak\",\n");
+    }
+
+    // raw() takes a separator like any field but copies the bytes as they are
+    {
+        CsvEncoder e;
+        e.add(1).raw("x,\"y\"").add(2);
+        e.endRow();
+        e.raw("first").endRow();
+        CHECK(text(e) == "1,x,\"y\",2\nfirst\n");
+    }
+
+    // flushTo writes everything and clears the buffer for the next row
+    {
+        char path[] = "/tmp/test_csv_encoderXXXXXX";
+        int fd = ::mkstemp(path);
+        CHECK(fd >= 0);
+        CsvEncoder e(8);
+        std::string expected;
+        for (int r = 0; r < 5000; ++r) {
+            e.add(r).add(r * 0.25).add("r");
+            e.endRow();
+            expected += std::to_string(r) + ',' + text(CsvEncoder().add(r * 0.25)) + ",r\n";
+        }
+        e.flushTo(fd, path);
+        CHECK(e.empty());
+        e.add(9).endRow();
+        CHECK(text(e) == "9\n");
+
+        std::string got(expected.size() + 1, '\0');
+        CHECK(::pread(fd, got.data(), got.size(), 0) == static_cast<ssize_t>(expected.size()));
+        got.resize(expected.size());
+        CHECK(got == expected);
+        ::close(fd);
+        ::unlink(path);
+
+        CHECK_THROWS(e.flushTo(-1, "fd -1"));
+    }
+
+    return test_result("csv_encoder");
+}
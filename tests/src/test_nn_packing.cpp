@@ -0,0 +1,115 @@
+#include "nn_packing.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <random>
+
+// Plaintext run of the packed forward of forwardPacked (openfheNN) and the
+// heaanNN packed path: cyclic rotations stand in for EvalRotate, slot-wise
+// products for the plaintext multiplications.
+
+using Vec = std::vector<double>;
+
+// EvalRotate(v, k): slot i takes slot i + k
+static Vec rot(const Vec& v, size_t k)
+{
+    Vec out(v.size());
+    for (size_t i = 0; i < v.size(); ++i)
+        out[i] = v[(i + k) % v.size()];
+    return out;
+}
+
+static void addInto(Vec& acc, const Vec& v)
+{
+    for (size_t i = 0; i < acc.size(); ++i)
+        acc[i] += v[i];
+}
+
+static Vec mul(const Vec& a, const Vec& b)
+{
+    Vec out(a.size());
+    for (size_t i = 0; i < a.size(); ++i)
+        out[i] = a[i] * b[i];
+    return out;
+}
+
+static void checkShape(size_t n, size_t hidden, size_t output, size_t input, uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+
+    std::vector<Vec> W1(hidden, Vec(input)), W2(output, Vec(hidden));
+    Vec b1(hidden), b2(output), x(n, 0.0);
+    for (auto& row : W1) for (auto& w : row) w = dist(gen);
+    for (auto& row : W2) for (auto& w : row) w = dist(gen);
+    for (auto& v : b1) v = dist(gen);
+    for (auto& v : b2) v = dist(gen);
+    for (size_t i = 0; i < input; ++i) x[i] = dist(gen);
+
+    const PackedMLPLayout L = packedLayout(n, hidden, output);
+    CHECK(L.n1 * L.n2 == L.m);
+    const auto diags = packedDiagonals(L, W1);
+    const auto steps = packedRotations(L);
+    auto scheduled = [&](size_t k) {
+        return std::find(steps.begin(), steps.end(), static_cast<int>(k)) != steps.end();
+    };
+
+    // z = sum_g rot( sum_b D[g*n1+b] * rot(x, b), g*n1 )
+    Vec z(n, 0.0);
+    for (size_t g = 0; g < L.n2; ++g) {
+        Vec inner(n, 0.0);
+        for (size_t b = 0; b < L.n1; ++b) {
+            CHECK(b == 0 || scheduled(b));
+            addInto(inner, mul(rot(x, b), diags[g * L.n1 + b]));
+        }
+        CHECK(g == 0 || scheduled(g * L.n1));
+        addInto(z, rot(inner, g * L.n1));
+    }
+    // Stride fold: every slot i gets h[i mod m]
+    for (size_t s = L.m; s < L.n; s <<= 1) {
+        CHECK(scheduled(s));
+        addInto(z, rot(z, s));
+    }
+    addInto(z, packedRepeat(L, b1));
+
+    for (size_t i = 0; i < n; ++i) {
+        const size_t j = i % hidden;
+        double h = b1[j];
+        for (size_t c = 0; c < input; ++c)
+            h += W1[j][c] * x[c];
+        CHECK_NEAR(z[i], h, 1e-9);
+    }
+
+    // Layer 2 on h (the activation is slot-wise, left out): logit o at slot o*m
+    Vec acc = mul(z, packedLayer2(L, W2));
+    for (size_t s = 1; s < L.m; s <<= 1) {
+        CHECK(scheduled(s));
+        addInto(acc, rot(acc, s));
+    }
+    addInto(acc, packedBias2(L, b2));
+
+    for (size_t o = 0; o < output; ++o) {
+        double y = b2[o];
+        for (size_t j = 0; j < hidden; ++j) {
+            double h = b1[j];
+            for (size_t c = 0; c < input; ++c)
+                h += W1[j][c] * x[c];
+            y += W2[o][j] * h;
+        }
+        CHECK_NEAR(acc[o * L.m], y, 1e-9);
+    }
+}
+
+int main()
+{
+    // Even and odd log2(hidden) (n1 = n2 and n1 = 2*n2), input below and at n
+    checkShape(16, 4, 2, 10, 1);
+    checkShape(64, 8, 3, 50, 2);
+    checkShape(64, 8, 8, 64, 3);
+    checkShape(1024, 32, 10, 784, 4);
+    checkShape(1024, 64, 10, 784, 5);
+
+    CHECK_THROWS(packedLayout(64, 6, 2));
+    CHECK_THROWS(packedLayout(16, 8, 4));
+    return test_result("nn_packing");
+}
@@ -0,0 +1,125 @@
+#include "snapshot_store.h"
+#include "test_check.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+static std::string readFile(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+static void writeFile(const std::string& path, const std::string& bytes)
+{
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+}
+
+// Header field at byte offset off, rewritten in place
+static void patchWord(std::string& bytes, size_t off, uint64_t v)
+{
+    std::memcpy(&bytes[off], &v, sizeof(v));
+}
+
+int main()
+{
+    char tmpl[] = "/tmp/test_snapshot_storeXXXXXX";
+    CHECK(::mkdtemp(tmpl) != nullptr);
+    const std::string dir = std::string(tmpl) + "/store";
+    SnapshotStore store(dir);
+    CHECK(std::filesystem::is_directory(dir));
+
+    // Round trip, with a description that needs padding
+    const std::string desc = "logN=12;seed=7;ops=encrypt";
+    SnapshotWriter w;
+    w.put(42);
+    w.putDouble(-0.125);
+    const uint64_t block[3] = {1, 2, ~uint64_t(0)};
+    w.putWords(block, 3);
+    uint64_t* tail = w.extend(2);
+    tail[0] = 5;
+    tail[1] = 6;
+
+    CHECK(store.load(desc) == nullptr);
+    store.store(desc, w);
+    {
+        auto snap = store.load(desc);
+        CHECK(snap != nullptr);
+        CHECK(snap->description() == desc);
+        SnapshotReader r = snap->reader();
+        CHECK(r.get() == 42);
+        CHECK(r.getDouble() == -0.125);
+        const uint64_t* b = r.take(3);
+        CHECK(b[0] == 1 && b[1] == 2 && b[2] == ~uint64_t(0));
+        CHECK(r.get() == 5 && r.get() == 6);
+        CHECK(r.done());
+        CHECK_THROWS(r.get());
+    }
+    // Nothing left behind but the snapshot itself
+    CHECK(std::distance(std::filesystem::directory_iterator(dir),
+                        std::filesystem::directory_iterator()) == 1);
+
+    // Empty description and payload
+    store.store("", SnapshotWriter());
+    {
+        auto snap = store.load("");
+        CHECK(snap != nullptr);
+        CHECK(snap->description().empty());
+        CHECK(snap->reader().done());
+    }
+
+    const std::string path = store.path(desc);
+    const std::string good = readFile(path);
+    CHECK(good.size() == sizeof(SnapshotHeader) + 32 + 7 * sizeof(uint64_t));
+
+    // A different description under the same name reads as a miss
+    {
+        const std::string other = "logN=13;seed=7;ops=encrypt";
+        store.store(other, w);
+        std::filesystem::copy_file(store.path(other), path,
+                                   std::filesystem::copy_options::overwrite_existing);
+        CHECK(store.load(desc) == nullptr);
+        writeFile(path, good);
+    }
+
+    // Truncated anywhere: inside the header, the description or the payload
+    for (size_t size : {size_t(0), sizeof(SnapshotHeader) - 1, sizeof(SnapshotHeader) + 10,
+                        good.size() - 1, good.size() - sizeof(uint64_t)}) {
+        writeFile(path, good.substr(0, size));
+        CHECK_THROWS(store.load(desc));
+    }
+
+    // Corrupt headers
+    {
+        std::string bad = good;
+        bad[0] = 'X';
+        writeFile(path, bad);
+        CHECK_THROWS(store.load(desc));
+
+        // descLen past the end of the file, also where align8 would wrap to
+        // 0; rejected when mapping, before description() is read
+        for (uint64_t descLen : {uint64_t(good.size()), ~uint64_t(0), ~uint64_t(0) - 6}) {
+            bad = good;
+            patchWord(bad, offsetof(SnapshotHeader, descLen), descLen);
+            writeFile(path, bad);
+            CHECK_THROWS(MappedSnapshot(path));
+        }
+
+        for (uint64_t words : {uint64_t(8), ~uint64_t(0), ~uint64_t(0) / 8 + 1}) {
+            bad = good;
+            patchWord(bad, offsetof(SnapshotHeader, words), words);
+            writeFile(path, bad);
+            CHECK_THROWS(store.load(desc));
+        }
+    }
+
+    writeFile(path, good);
+    CHECK(store.load(desc) != nullptr);
+
+    std::filesystem::remove_all(tmpl);
+    return test_result("snapshot_store");
+}